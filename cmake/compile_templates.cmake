@@ -0,0 +1,177 @@
+# Compiles the ActionScript templates into C++ render functions returned by Template::getBuiltin.
+# Runs in script mode: cmake -DOUTPUT=<file.cpp> -DTEMPLATE_DIR=<dir> -P compile_templates.cmake
+#
+# Every template becomes one function writing its literals and variable slots straight into the
+# output buffer, plus one function per line that loop lines are repeated with.
+
+file(GLOB TEMPLATES ${TEMPLATE_DIR}/*.as)
+list(SORT TEMPLATES)
+set(KNOWN_VARIABLES width height bgcolor fps name path mime count x y alpha visible arraytype)
+
+function(escape_literal TEXT RESULT)
+	string(REPLACE "\\" "\\\\" TEXT "${TEXT}")
+	string(REPLACE "\"" "\\\"" TEXT "${TEXT}")
+	string(REPLACE "?" "\\?" TEXT "${TEXT}")
+	string(REPLACE "\t" "\\t" TEXT "${TEXT}")
+	string(REPLACE "\n" "\\n" TEXT "${TEXT}")
+	set(${RESULT} "${TEXT}" PARENT_SCOPE)
+endfunction()
+
+set(CODE "// generated by cmake/compile_templates.cmake, do not edit\n\n#include \"Template.h\"\n\nnamespace {\n")
+set(LOOKUP "")
+
+foreach(SOURCE ${TEMPLATES})
+	get_filename_component(FILE_NAME "${SOURCE}" NAME)
+	get_filename_component(BASE_NAME "${SOURCE}" NAME_WE)
+	string(TOUPPER "${BASE_NAME}" PREFIX)
+	file(READ "${SOURCE}" CONTENT)
+	string(REPLACE "\r" "" CONTENT "${CONTENT}")
+	string(LENGTH "${CONTENT}" SIZE)
+
+	set(LINES "")
+	set(LINE_COUNT 0)
+	set(LITERAL_COUNT 0)
+	# literal only lines are merged into one append of the template function
+	set(PENDING "")
+	set(BODY "")
+	set(USES_VALUES FALSE)
+	set(USES_LOOP FALSE)
+	string(LENGTH "${CONTENT}" LEFT)
+	while(LEFT GREATER 0)
+		string(FIND "${CONTENT}" "\n" EOL)
+		if(EOL EQUAL -1)
+			set(LINE "${CONTENT}")
+			set(CONTENT "")
+		else()
+			math(EXPR NEXT "${EOL} + 1")
+			string(SUBSTRING "${CONTENT}" 0 ${NEXT} LINE)
+			string(SUBSTRING "${CONTENT}" ${NEXT} -1 CONTENT)
+		endif()
+		string(LENGTH "${CONTENT}" LEFT)
+
+		# split the line into literal and variable segments like Template::addLine
+		set(FUNCTION "${PREFIX}_${LINE_COUNT}")
+		set(LOOP "Template::NONE")
+		set(STATEMENTS "")
+		set(LITERALS "")
+		set(VARIABLE_COUNT 0)
+		set(LITERAL "")
+		set(WHOLE "")
+		string(LENGTH "${LINE}" REST)
+		while(REST GREATER 0)
+			string(FIND "${LINE}" "\${" BEGIN)
+			set(END -1)
+			if(BEGIN GREATER -1)
+				math(EXPR FROM "${BEGIN} + 3")
+				if(FROM LESS REST)
+					string(SUBSTRING "${LINE}" ${FROM} -1 TAIL)
+					string(FIND "${TAIL}" "}" END)
+					if(END GREATER -1)
+						math(EXPR END "${END} + ${FROM}")
+					endif()
+				endif()
+			endif()
+			if(END EQUAL -1)
+				set(LITERAL "${LITERAL}${LINE}")
+				set(LINE "")
+			else()
+				string(SUBSTRING "${LINE}" 0 ${BEGIN} HEAD)
+				math(EXPR NAME_BEGIN "${BEGIN} + 2")
+				math(EXPR NAME_LENGTH "${END} - ${NAME_BEGIN}")
+				math(EXPR NEXT "${END} + 1")
+				string(SUBSTRING "${LINE}" ${NAME_BEGIN} ${NAME_LENGTH} VARIABLE)
+				string(SUBSTRING "${LINE}" ${NEXT} -1 LINE)
+				set(LITERAL "${LITERAL}${HEAD}")
+
+				list(FIND KNOWN_VARIABLES "${VARIABLE}" KNOWN)
+				if(VARIABLE STREQUAL "loop1")
+					set(LOOP "Template::LOOP1")
+				elseif(VARIABLE STREQUAL "loop2")
+					set(LOOP "Template::LOOP2")
+				elseif(KNOWN EQUAL -1)
+					message(WARNING "${FILE_NAME}: undefined variable \${${VARIABLE}}")
+					set(LITERAL "${LITERAL}\${${VARIABLE}}")
+				else()
+					if(NOT LITERAL STREQUAL "")
+						escape_literal("${LITERAL}" ESCAPED)
+						set(ARRAY "${FUNCTION}_${LITERAL_COUNT}")
+						math(EXPR LITERAL_COUNT "${LITERAL_COUNT} + 1")
+						set(LITERALS "${LITERALS}const char ${ARRAY}[] = \"${ESCAPED}\";\n")
+						set(STATEMENTS "${STATEMENTS}\tout.append(${ARRAY}, sizeof(${ARRAY}) - 1);\n")
+						set(WHOLE "${WHOLE}${LITERAL}")
+						set(LITERAL "")
+					endif()
+					string(TOUPPER "${VARIABLE}" ID)
+					set(STATEMENTS "${STATEMENTS}\tif (!Template::appendValue(values, Template::${ID}, \"\${${VARIABLE}}\", out)) {\n\t\tout.truncate(start);\n\t\treturn;\n\t}\n")
+					math(EXPR VARIABLE_COUNT "${VARIABLE_COUNT} + 1")
+				endif()
+			endif()
+			string(LENGTH "${LINE}" REST)
+		endwhile()
+		if(NOT LITERAL STREQUAL "")
+			escape_literal("${LITERAL}" ESCAPED)
+			set(ARRAY "${FUNCTION}_${LITERAL_COUNT}")
+			math(EXPR LITERAL_COUNT "${LITERAL_COUNT} + 1")
+			set(LITERALS "${LITERALS}const char ${ARRAY}[] = \"${ESCAPED}\";\n")
+			set(STATEMENTS "${STATEMENTS}\tout.append(${ARRAY}, sizeof(${ARRAY}) - 1);\n")
+			set(WHOLE "${WHOLE}${LITERAL}")
+		endif()
+
+		if(VARIABLE_COUNT EQUAL 0)
+			set(CODE "${CODE}${LITERALS}void ${FUNCTION} (const Template::Values&, QByteArray& out)\n{\n${STATEMENTS}}\n\n")
+		else()
+			set(CODE "${CODE}${LITERALS}void ${FUNCTION} (const Template::Values& values, QByteArray& out)\n{\n\tconst int start = out.size();\n${STATEMENTS}}\n\n")
+		endif()
+		set(LINES "${LINES}\t{ ${FUNCTION}, ${LOOP} },\n")
+
+		# the template function appends literal runs at once and calls the lines holding variables
+		if(VARIABLE_COUNT EQUAL 0 AND LOOP STREQUAL "Template::NONE")
+			set(PENDING "${PENDING}${WHOLE}")
+		else()
+			if(NOT PENDING STREQUAL "")
+				escape_literal("${PENDING}" ESCAPED)
+				set(ARRAY "${PREFIX}_TEXT_${LINE_COUNT}")
+				set(CODE "${CODE}const char ${ARRAY}[] = \"${ESCAPED}\";\n")
+				set(BODY "${BODY}\tout.append(${ARRAY}, sizeof(${ARRAY}) - 1);\n")
+				set(PENDING "")
+			endif()
+			set(USES_VALUES TRUE)
+			if(LOOP STREQUAL "Template::NONE")
+				set(BODY "${BODY}\t${FUNCTION}(values, out);\n")
+			else()
+				set(USES_LOOP TRUE)
+				set(BODY "${BODY}\tif (expand) {\n\t\texpand(context, lines[${LINE_COUNT}], out);\n\t} else {\n\t\t${FUNCTION}(values, out);\n\t}\n")
+			endif()
+		endif()
+		set(LITERAL_COUNT 0)
+		math(EXPR LINE_COUNT "${LINE_COUNT} + 1")
+	endwhile()
+	if(NOT PENDING STREQUAL "")
+		escape_literal("${PENDING}" ESCAPED)
+		set(ARRAY "${PREFIX}_TEXT_${LINE_COUNT}")
+		set(CODE "${CODE}const char ${ARRAY}[] = \"${ESCAPED}\";\n")
+		set(BODY "${BODY}\tout.append(${ARRAY}, sizeof(${ARRAY}) - 1);\n")
+	endif()
+
+	set(CODE "${CODE}constexpr Template::LineData ${PREFIX}[] = {\n${LINES}};\n\n")
+	if(USES_LOOP)
+		set(BODY "\tconst Template::LineList& lines = compiled.getLines();\n${BODY}")
+		set(PARAMETERS "const Template& compiled, const Template::Values& values, Template::Expander expand,\n\t\tconst void* context, QByteArray& out")
+	elseif(USES_VALUES)
+		set(PARAMETERS "const Template&, const Template::Values& values, Template::Expander, const void*, QByteArray& out")
+	else()
+		set(PARAMETERS "const Template&, const Template::Values&, Template::Expander, const void*, QByteArray& out")
+	endif()
+	set(CODE "${CODE}void render${PREFIX} (${PARAMETERS})\n{\n${BODY}}\n\n")
+	set(LOOKUP "${LOOKUP}\tif (name == QLatin1String(\"${FILE_NAME}\")) {\n\t\tstatic const Template compiled(${PREFIX}, ${LINE_COUNT}, render${PREFIX}, ${SIZE});\n\t\treturn &compiled;\n\t}\n")
+endforeach()
+
+set(CODE "${CODE}}\n\nconst Template* Template::getBuiltin (const QString& name)\n{\n${LOOKUP}\treturn NULL;\n}\n")
+
+# keep the timestamp when nothing changed so the generated file is not rebuilt
+if(EXISTS "${OUTPUT}")
+	file(READ "${OUTPUT}" PREVIOUS)
+endif()
+if(NOT PREVIOUS STREQUAL CODE)
+	file(WRITE "${OUTPUT}" "${CODE}")
+endif()
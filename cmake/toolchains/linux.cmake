@@ -6,3 +6,10 @@ if (CMAKE_COMPILER_IS_GNUCXX)
 else()
 	message(ERROR "unsupported compiler")
 endif()
+
+include(CheckCXXSourceCompiles)
+check_cxx_source_compiles("#include <linux/io_uring.h>
+int main () { return IORING_OP_STATX + IORING_FEAT_SINGLE_MMAP; }" HAVE_IO_URING)
+if (HAVE_IO_URING)
+	add_definitions(-DHAVE_IO_URING)
+endif()
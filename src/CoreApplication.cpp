@@ -42,12 +42,20 @@
 using namespace CreateSWF::Internal;
 
 CoreApplication::CoreApplication (int &argc, char** argv) :
-	QApplication(argc, argv), _compiler(), _flexHome(), _gui(false), _debug(false), _swc(false)
+	QApplication(argc, argv), _compiler(), _parser(NULL), _placements(), _watcher(NULL), _flexHome(), _movieclipPattern("^mc\\d+__"),
+	_spritePattern("^sp\\d+__"), _suffixPattern("___"), _templateDir(), _gui(false), _debug(false), _swc(false), _watch(false), _rescan(false),
+	_sniff(false), _consolidate(false), _keepWorkspace(false),
+	_reproducible(false), _jobs(1)
 {
 }
 
 CoreApplication::~CoreApplication ()
 {
+	delete _watcher;
+	delete _parser;
+	if (_watch && !_debug && !_keepWorkspace) {
+		System.removeDir(System.getTempDir().path());
+	}
 }
 
 void CoreApplication::setModeGUI (bool enabled)
@@ -64,18 +72,25 @@ void CoreApplication::setFlexHome (QDir& flexHome)
 	_flexHome = flexHome;
 }
 
-bool CoreApplication::compile (const QDir& dir, DefinitionParser::CompileArguments& c) const
+bool CoreApplication::compile (const QDir& dir, DefinitionParser::CompileArguments& c)
 {
 	AbstractAssetsParser* parser = NULL;
+	DirectoryParser* directoryParser = NULL;
+	_placements.files.clear();
+	_placements.classes.clear();
 
 	if (dir.exists(DEFINITION_NAME)) {
 		DefinitionParser* p = new DefinitionParser();
 		p->setTargetDir(dir);
 		p->getCompileArguments(c);
-		if (c.mode != CompileMode::COMPILE_DEFINITION) {
-			delete p;
-		} else {
+		if (c.mode == CompileMode::COMPILE_DEFINITION) {
 			parser = p;
+		} else {
+			// the definition only contributes the placements of the files the directory scan finds
+			if (c.mode == CompileMode::COMPILE_ALL_WITH_DEFINITION) {
+				p->indexPlacements(_placements);
+			}
+			delete p;
 		}
 	}
 
@@ -89,17 +104,37 @@ bool CoreApplication::compile (const QDir& dir, DefinitionParser::CompileArgumen
 
 		DirectoryParser* p = new DirectoryParser();
 		p->setTargetDir(dir);
-		p->setMovieclipPattern("^mc\\d+__");
-		p->setSpritePattern("^sp\\d+__");
-		p->setSuffixIgnorePattern("___");
-		parser = p;
+		if (!p->setMovieclipPattern(_movieclipPattern)) {
+			System.exit("invalid movieclip pattern \'" + _movieclipPattern + "\'", EXIT_FAILURE);
+		}
+		if (!p->setSpritePattern(_spritePattern)) {
+			System.exit("invalid sprite pattern \'" + _spritePattern + "\'", EXIT_FAILURE);
+		}
+		p->setSuffixIgnorePattern(_suffixPattern);
+		p->setIncremental(_watch);
+		p->setRescan(_rescan);
+		p->setPlacements(_placements.files.isEmpty() && _placements.classes.isEmpty() ? NULL : &_placements);
+		parser = directoryParser = p;
 	}
 
 	parser->setTempDir(System.getTempDir());
 	parser->setUseVector(!(c.player < 11));
+	parser->setSniffTypes(_sniff);
+	parser->setConsolidate(_consolidate);
+	parser->setKeepWorkspace(_keepWorkspace);
+	parser->setReproducible(_reproducible);
+	if (!_templateDir.path().isEmpty()) {
+		parser->setTemplateDir(_templateDir);
+	}
+	parser->setJobs(_jobs);
 	parser->parse();
 
-	delete parser;
+	if (_watch && directoryParser) {
+		delete _parser;
+		_parser = directoryParser;
+	} else {
+		delete parser;
+	}
 	parser = NULL;
 
 	QString output = c.name;
@@ -133,6 +168,35 @@ bool CoreApplication::compile (const QDir& dir, DefinitionParser::CompileArgumen
 	return true;
 }
 
+bool CoreApplication::watch (const QDir& dir)
+{
+	if (!_parser) {
+		warning("watch mode is only available when compiling all assets of a directory");
+		return false;
+	}
+	_watcher = new DirectoryWatcher();
+	if (!_watcher->watch(dir)) {
+		return false;
+	}
+	connect(_watcher, SIGNAL(changed()), this, SLOT(rebuild()));
+	return true;
+}
+
+void CoreApplication::rebuild ()
+{
+	if (!_parser->update(_watcher->takeChanges())) {
+		return;
+	}
+
+	_compiler.execute();
+
+	if (!_gui) {
+		QProcess* process = _compiler.getProcess();
+		process->waitForFinished();
+		onProcessComplete(process->exitCode(), process->exitStatus());
+	}
+}
+
 void CoreApplication::onProcessComplete (int exitCode, QProcess::ExitStatus status) const
 {
 	QString msg;
@@ -154,7 +218,7 @@ void CoreApplication::onProcessComplete (int exitCode, QProcess::ExitStatus stat
 	if (_gui) {
 		emit processComplete(exitCode, status, msg);
 	}
-	if (!_debug) {
+	if (!_debug && !_watch && !_keepWorkspace) {
 		System.removeDir(System.getTempDir().path());
 	}
 }
@@ -171,11 +235,66 @@ void CoreApplication::setDebug (bool debug)
 	_debug = debug;
 }
 
+void CoreApplication::setWatch (bool watch)
+{
+	_watch = watch;
+}
+
+void CoreApplication::setRescan (bool rescan)
+{
+	_rescan = rescan;
+}
+
+void CoreApplication::setSniff (bool sniff)
+{
+	_sniff = sniff;
+}
+
+void CoreApplication::setConsolidate (bool consolidate)
+{
+	_consolidate = consolidate;
+}
+
+void CoreApplication::setKeepWorkspace (bool keep)
+{
+	_keepWorkspace = keep;
+}
+
+void CoreApplication::setReproducible (bool reproducible)
+{
+	_reproducible = reproducible;
+}
+
 void CoreApplication::setSWC (bool swc)
 {
 	_swc = swc;
 }
 
+void CoreApplication::setJobs (int jobs)
+{
+	_jobs = jobs;
+}
+
+void CoreApplication::setMovieclipPattern (const QString& pattern)
+{
+	_movieclipPattern = pattern;
+}
+
+void CoreApplication::setSpritePattern (const QString& pattern)
+{
+	_spritePattern = pattern;
+}
+
+void CoreApplication::setSuffixPattern (const QString& pattern)
+{
+	_suffixPattern = pattern;
+}
+
+void CoreApplication::setTemplateDir (const QDir& dir)
+{
+	_templateDir = dir;
+}
+
 bool CoreApplication::event (QEvent* event)
 {
 	if (event->type() == QEvent::FileOpen) {
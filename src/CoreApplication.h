@@ -30,6 +30,9 @@
 
 #include "common/Compiler.h"
 #include "parsers/DefinitionParser.h"
+#include "parsers/DirectoryParser.h"
+#include "parsers/Placement.h"
+#include "ports/DirectoryWatcher.h"
 
 #include <QApplication>
 #include <QDir>
@@ -49,20 +52,49 @@ public:
 	void setFlexHome (QDir& flexHome);
 	void setSWC (bool swc);
 	void setDebug (bool debug);
+	void setWatch (bool watch);
+	void setRescan (bool rescan);
+	void setSniff (bool sniff);
+	void setConsolidate (bool consolidate);
+	void setKeepWorkspace (bool keep);
+	void setReproducible (bool reproducible);
+	void setJobs (int jobs);
+	void setMovieclipPattern (const QString& pattern);
+	void setSpritePattern (const QString& pattern);
+	void setSuffixPattern (const QString& pattern);
+	void setTemplateDir (const QDir& dir);
 
 public slots:
 	void terminateCompilation ();
 
 public slots:
-	bool compile (const QDir& dir, DefinitionParser::CompileArguments& c) const;
+	bool compile (const QDir& dir, DefinitionParser::CompileArguments& c);
+	bool watch (const QDir& dir);
 	void onProcessComplete (int exitCode, QProcess::ExitStatus status) const;
 
+private slots:
+	void rebuild ();
+
 private:
 	mutable Compiler _compiler;
+	DirectoryParser* _parser;
+	PlacementIndex _placements;
+	DirectoryWatcher* _watcher;
 	QDir _flexHome;
+	QString _movieclipPattern;
+	QString _spritePattern;
+	QString _suffixPattern;
+	QDir _templateDir;
 	bool _gui;
 	bool _debug;
 	bool _swc;
+	bool _watch;
+	bool _rescan;
+	bool _sniff;
+	bool _consolidate;
+	bool _keepWorkspace;
+	bool _reproducible;
+	int _jobs;
 
 	bool event (QEvent *);
 
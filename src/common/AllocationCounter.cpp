@@ -0,0 +1,106 @@
+/*
+ * AllocationCounter.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "common/AllocationCounter.h"
+
+#ifdef ALLOCATION_GUARD
+
+#include <new>
+#include <stdlib.h>
+
+namespace {
+thread_local unsigned long allocations = 0;
+}
+
+unsigned long AllocationCounter::get ()
+{
+	return allocations;
+}
+
+#ifdef __GLIBC__
+// Qt containers allocate through malloc, glibc lets the executable interpose it
+extern "C" {
+void* __libc_malloc (size_t size);
+void* __libc_calloc (size_t count, size_t size);
+void* __libc_realloc (void* ptr, size_t size);
+
+void* malloc (size_t size)
+{
+	++allocations;
+	return __libc_malloc(size);
+}
+
+void* calloc (size_t count, size_t size)
+{
+	++allocations;
+	return __libc_calloc(count, size);
+}
+
+void* realloc (void* ptr, size_t size)
+{
+	++allocations;
+	return __libc_realloc(ptr, size);
+}
+}
+#else
+// elsewhere only the C++ allocations are seen
+void* operator new (size_t size)
+{
+	++allocations;
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[] (size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete (void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[] (void* ptr) noexcept
+{
+	free(ptr);
+}
+#endif
+
+#else
+
+unsigned long AllocationCounter::get ()
+{
+	return 0;
+}
+
+#endif
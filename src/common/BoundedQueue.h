@@ -0,0 +1,112 @@
+/*
+ * BoundedQueue.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+ * Blocking FIFO with a fixed capacity shared by producer and consumer threads. push() waits while
+ * the queue is full, pop() waits while it is empty and returns false once the queue is closed
+ * and drained.
+ */
+template<typename T>
+class BoundedQueue {
+private:
+	BoundedQueue (const BoundedQueue&);
+	BoundedQueue& operator= (const BoundedQueue&);
+
+public:
+	explicit BoundedQueue (size_t capacity) :
+		_items(), _lock(), _notFull(), _notEmpty(), _capacity(capacity), _closed(false)
+	{
+	}
+
+	bool push (const T& item)
+	{
+		std::unique_lock<std::mutex> guard(_lock);
+		while (_items.size() >= _capacity && !_closed) {
+			_notFull.wait(guard);
+		}
+		if (_closed) {
+			return false;
+		}
+		_items.push_back(item);
+		_notEmpty.notify_one();
+		return true;
+	}
+
+	bool push (T&& item)
+	{
+		std::unique_lock<std::mutex> guard(_lock);
+		while (_items.size() >= _capacity && !_closed) {
+			_notFull.wait(guard);
+		}
+		if (_closed) {
+			return false;
+		}
+		_items.push_back(std::move(item));
+		_notEmpty.notify_one();
+		return true;
+	}
+
+	bool pop (T& item)
+	{
+		std::unique_lock<std::mutex> guard(_lock);
+		while (_items.empty() && !_closed) {
+			_notEmpty.wait(guard);
+		}
+		if (_items.empty()) {
+			return false;
+		}
+		item = std::move(_items.front());
+		_items.pop_front();
+		_notFull.notify_one();
+		return true;
+	}
+
+	void close ()
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_closed = true;
+		_notFull.notify_all();
+		_notEmpty.notify_all();
+	}
+
+private:
+	std::deque<T> _items;
+	std::mutex _lock;
+	std::condition_variable _notFull;
+	std::condition_variable _notEmpty;
+	size_t _capacity;
+	bool _closed;
+};
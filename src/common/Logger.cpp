@@ -29,7 +29,7 @@
 #include "Logger.h"
 
 Logger::Logger () :
-	_in(stdin), _out(stdout), _err(stderr)
+	_in(stdin), _out(stdout), _err(stderr), _lock()
 {
 }
 
@@ -39,24 +39,28 @@ Logger::~Logger ()
 
 void Logger::logInfo (const QString &string) const
 {
+	std::lock_guard<std::mutex> guard(_lock);
 	_out << "Info: " + string + "\n";
 	_out.flush();
 }
 
 void Logger::logWarning (const QString &string) const
 {
+	std::lock_guard<std::mutex> guard(_lock);
 	_out << "Warning: " + string + "\n";
 	_out.flush();
 }
 
 void Logger::logError (const QString &string) const
 {
+	std::lock_guard<std::mutex> guard(_lock);
 	_err << "Error: " + string + "\n";
 	_err.flush();
 }
 
 void Logger::logDebug (const QString &string) const
 {
+	std::lock_guard<std::mutex> guard(_lock);
 	_out << "Debug: " + string + "\n";
 	_out.flush();
 }
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <mutex>
 #include <QTextStream>
 
 class Logger {
@@ -36,6 +37,7 @@ private:
 	mutable QTextStream _in;
 	mutable QTextStream _out;
 	mutable QTextStream _err;
+	mutable std::mutex _lock;
 
 public:
 	Logger ();
@@ -0,0 +1,117 @@
+/*
+ * StringView.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <string.h>
+
+#include <QByteArray>
+
+/**
+ * Non-owning view of UTF-8 bytes, the pre C++17 stand-in for std::string_view. The viewed
+ * buffer must outlive the view. A default constructed view is null, which is distinct from empty.
+ */
+class StringView {
+public:
+	StringView () :
+		_data(NULL), _size(0)
+	{
+	}
+
+	StringView (const char* data, int size) :
+		_data(data), _size(size)
+	{
+	}
+
+	StringView (const char* text) :
+		_data(text), _size(int(strlen(text)))
+	{
+	}
+
+	StringView (const QByteArray& bytes) :
+		_data(bytes.constData()), _size(bytes.size())
+	{
+	}
+
+	const char* data () const
+	{
+		return _data;
+	}
+
+	int size () const
+	{
+		return _size;
+	}
+
+	bool isNull () const
+	{
+		return _data == NULL;
+	}
+
+	bool isEmpty () const
+	{
+		return _size == 0;
+	}
+
+	bool operator== (const StringView& other) const
+	{
+		return _size == other._size && (_size == 0 || memcmp(_data, other._data, _size) == 0);
+	}
+
+private:
+	const char* _data;
+	int _size;
+};
+
+/**
+ * Decimal text of a number formatted into an inline buffer, so counters never touch the heap.
+ * Views taken from it are valid as long as the Decimal itself.
+ */
+class Decimal {
+public:
+	explicit Decimal (unsigned int value) :
+		_begin(SIZE)
+	{
+		do {
+			_digits[--_begin] = char('0' + value % 10);
+			value /= 10;
+		} while (value);
+	}
+
+	StringView view () const
+	{
+		return StringView(_digits + _begin, SIZE - _begin);
+	}
+
+private:
+	static const int SIZE = 10;
+
+	char _digits[SIZE];
+	int _begin;
+};
@@ -32,33 +32,48 @@
 
 namespace Content {
 
+typedef enum Class {
+	UNDEFINED = 0, SPRITE, MOVIECLIP, EXTSPRITE, EXTMOVIECLIP, BITMAPDATA, SOUND, BYTEARRAY, HOLDER
+} Class;
+
+/**
+ * Compile time traits of each kind of generated class. The name doubles as the template the class
+ * is rendered from and, for embedded assets, the ActionScript base class.
+ */
+template <Class C> struct Traits;
+template <> struct Traits<UNDEFINED> { static constexpr const char* name () { return "[invalid]"; } };
+template <> struct Traits<SPRITE> { static constexpr const char* name () { return "Sprite"; } };
+template <> struct Traits<MOVIECLIP> { static constexpr const char* name () { return "MovieClip"; } };
+template <> struct Traits<EXTSPRITE> { static constexpr const char* name () { return "ExtendedSprite"; } };
+template <> struct Traits<EXTMOVIECLIP> { static constexpr const char* name () { return "ExtendedMovieClip"; } };
+template <> struct Traits<BITMAPDATA> { static constexpr const char* name () { return "BitmapData"; } };
+template <> struct Traits<SOUND> { static constexpr const char* name () { return "Sound"; } };
+template <> struct Traits<BYTEARRAY> { static constexpr const char* name () { return "ByteArray"; } };
+template <> struct Traits<HOLDER> { static constexpr const char* name () { return "EmbeddedAssets"; } };
+
 const QString STR_MAIN = "Main";
-const QString STR_EXTMOVIECLIP = "ExtendedMovieClip";
-const QString STR_EXTSPRITE = "ExtendedSprite";
-const QString STR_MOVIECLIP = "MovieClip";
-const QString STR_SPRITE = "Sprite";
-const QString STR_BITMAPDATA = "BitmapData";
-const QString STR_SOUND = "Sound";
-const QString STR_BYTEARRAY = "ByteArray";
+const QString STR_EXTMOVIECLIP = Traits<EXTMOVIECLIP>::name();
+const QString STR_EXTSPRITE = Traits<EXTSPRITE>::name();
+const QString STR_MOVIECLIP = Traits<MOVIECLIP>::name();
+const QString STR_SPRITE = Traits<SPRITE>::name();
+const QString STR_BITMAPDATA = Traits<BITMAPDATA>::name();
+const QString STR_SOUND = Traits<SOUND>::name();
+const QString STR_BYTEARRAY = Traits<BYTEARRAY>::name();
+const QString STR_HOLDER = Traits<HOLDER>::name();
 const QString STR_DOT_AS = ".as";
 const QString STR_DOT_SWF = ".swf";
 const QString STR_DOT_SWC = ".swc";
 
-typedef enum Class {
-	UNDEFINED = 0, SPRITE, MOVIECLIP, EXTSPRITE, EXTMOVIECLIP, BITMAPDATA, SOUND, BYTEARRAY
-} Class;
+// class names in enum order
+constexpr const char* NAMES[] = {
+	Traits<UNDEFINED>::name(), Traits<SPRITE>::name(), Traits<MOVIECLIP>::name(),
+	Traits<EXTSPRITE>::name(), Traits<EXTMOVIECLIP>::name(), Traits<BITMAPDATA>::name(),
+	Traits<SOUND>::name(), Traits<BYTEARRAY>::name(), Traits<HOLDER>::name()
+};
+static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == HOLDER + 1, "every class needs its traits listed");
 
 inline const QString getContentName (Class clazz)
 {
-	switch (clazz) {
-	case EXTSPRITE: return STR_EXTSPRITE;
-	case EXTMOVIECLIP: return STR_EXTMOVIECLIP;
-	case SPRITE: return STR_SPRITE;
-	case MOVIECLIP:	return STR_MOVIECLIP;
-	case BITMAPDATA: return STR_BITMAPDATA;
-	case SOUND:	return STR_SOUND;
-	case BYTEARRAY:	return STR_BYTEARRAY;
-	default: return "[invalid]";
-	}
+	return QString(NAMES[unsigned(clazz) <= HOLDER ? clazz : UNDEFINED]);
 }
 }
@@ -0,0 +1,104 @@
+/*
+ * EmbedTraits.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include "constants/Content.h"
+#include "constants/FileType.h"
+
+namespace Embed {
+
+/**
+ * Compile time traits of each file type: the class its embed is generated as and the mime type
+ * it is embedded with. A new type only needs its specialization and an entry in TABLE.
+ */
+template <File::Type T> struct Traits {
+	static constexpr Content::Class clazz () { return Content::BYTEARRAY; }
+	static constexpr const char* mime () { return "application/octet-stream"; }
+};
+
+template <> struct Traits<File::UNSUPPORTED> {
+	static constexpr Content::Class clazz () { return Content::UNDEFINED; }
+	static constexpr const char* mime () { return "application/octet-stream"; }
+};
+
+template <> struct Traits<File::PNG> {
+	static constexpr Content::Class clazz () { return Content::BITMAPDATA; }
+	static constexpr const char* mime () { return "image/png"; }
+};
+
+template <> struct Traits<File::JPG> {
+	static constexpr Content::Class clazz () { return Content::BITMAPDATA; }
+	static constexpr const char* mime () { return "image/jpg"; }
+};
+
+template <> struct Traits<File::GIF> {
+	static constexpr Content::Class clazz () { return Content::BITMAPDATA; }
+	static constexpr const char* mime () { return "image/gif"; }
+};
+
+template <> struct Traits<File::MP3> {
+	static constexpr Content::Class clazz () { return Content::SOUND; }
+	static constexpr const char* mime () { return "audio/mpeg"; }
+};
+
+struct Info {
+	File::Type type;
+	Content::Class clazz;
+	const char* mime;
+};
+
+template <File::Type T> constexpr Info makeInfo ()
+{
+	return Info { T, Traits<T>::clazz(), Traits<T>::mime() };
+}
+
+// traits of every file type in enum order for lookups of a type only known at runtime
+constexpr Info TABLE[] = {
+	makeInfo<File::UNSUPPORTED>(), makeInfo<File::PNG>(), makeInfo<File::JPG>(), makeInfo<File::GIF>(),
+	makeInfo<File::BMP>(), makeInfo<File::WAV>(), makeInfo<File::MP3>(), makeInfo<File::OGG>(),
+	makeInfo<File::SWF>(), makeInfo<File::XML>(), makeInfo<File::TXT>(), makeInfo<File::JSON>(),
+	makeInfo<File::BIN>()
+};
+
+const unsigned int TABLE_SIZE = sizeof(TABLE) / sizeof(TABLE[0]);
+
+constexpr bool isOrdered (unsigned int i = 0)
+{
+	return i == TABLE_SIZE || (TABLE[i].type == File::Type(i) && isOrdered(i + 1));
+}
+
+static_assert(TABLE_SIZE == File::BIN + 1, "every file type needs an entry");
+static_assert(isOrdered(), "entries must be listed in enum order");
+
+inline const Info& getInfo (File::Type type)
+{
+	return TABLE[unsigned(type) < TABLE_SIZE ? type : File::UNSUPPORTED];
+}
+}
@@ -0,0 +1,87 @@
+/*
+ * FileType.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "FileType.h"
+
+#include <string.h>
+
+#include <QFile>
+
+namespace {
+const int SNIFF_SIZE = 12;
+
+// one read buffer per thread, the generator threads sniff concurrently
+thread_local unsigned char buffer[SNIFF_SIZE];
+
+bool startsWith (const unsigned char* data, qint64 size, const char* magic, int offset = 0)
+{
+	const qint64 length = qint64(strlen(magic));
+	return size >= offset + length && memcmp(data + offset, magic, size_t(length)) == 0;
+}
+
+File::Type matchMagic (const unsigned char* data, qint64 size)
+{
+	if (startsWith(data, size, "\x89PNG\r\n\x1a\n")) return File::PNG;
+	if (startsWith(data, size, "\xff\xd8\xff")) return File::JPG;
+	if (startsWith(data, size, "GIF87a") || startsWith(data, size, "GIF89a")) return File::GIF;
+	if (startsWith(data, size, "RIFF") && startsWith(data, size, "WAVE", 8)) return File::WAV;
+	if (startsWith(data, size, "OggS")) return File::OGG;
+	if (startsWith(data, size, "FWS") || startsWith(data, size, "CWS") || startsWith(data, size, "ZWS")) return File::SWF;
+	if (startsWith(data, size, "ID3") || (size >= 2 && data[0] == 0xff && (data[1] & 0xe0) == 0xe0)) return File::MP3;
+	if (startsWith(data, size, "BM")) return File::BMP;
+	return File::UNSUPPORTED;
+}
+}
+
+File::Type File::sniffType (const QString& path, Type fallback)
+{
+	// text and generic binaries have no reliable signature, only media types are sniffed
+	switch (fallback) {
+	case PNG:
+	case JPG:
+	case GIF:
+	case BMP:
+	case WAV:
+	case MP3:
+	case OGG:
+	case SWF:
+		break;
+	default:
+		return fallback;
+	}
+
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return fallback;
+	}
+	const qint64 size = file.read(reinterpret_cast<char*>(buffer), SNIFF_SIZE);
+	file.close();
+
+	const Type type = matchMagic(buffer, size);
+	return type == UNSUPPORTED ? fallback : type;
+}
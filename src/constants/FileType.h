@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <QByteArray>
 #include <QString>
 
 namespace File {
@@ -35,26 +36,110 @@ typedef enum Type {
 	UNSUPPORTED = 0, PNG, JPG, GIF, BMP, WAV, MP3, OGG, SWF, XML, TXT, JSON, BIN
 } Type;
 
-inline Type getType (const QString& type)
+/**
+ * Supported extensions in a perfect hash table. An extension of up to four characters is packed
+ * little endian into a 32 bit key, the multiplicative hash below maps every registered key to its
+ * own slot so a lookup is a single compare.
+ */
+namespace Registry {
+struct Extension {
+	unsigned int key;
+	Type type;
+};
+
+const int TABLE_BITS = 4;
+const int TABLE_SIZE = 1 << TABLE_BITS;
+const unsigned int HASH_MULTIPLIER = 121527;
+
+constexpr unsigned int makeKey (const char* ext, int i = 0)
+{
+	return ext[i] == 0 || i == 4 ? 0 : (unsigned int) (unsigned char) ext[i] << (8 * i) | makeKey(ext, i + 1);
+}
+
+constexpr int slot (unsigned int key)
+{
+	return int((key * HASH_MULTIPLIER) >> (32 - TABLE_BITS));
+}
+
+constexpr Extension TABLE[TABLE_SIZE] = {
+	{ makeKey("swf"), SWF },
+	{ makeKey("xml"), XML },
+	{ makeKey("exe"), BIN },
+	{ 0, UNSUPPORTED },
+	{ makeKey("json"), JSON },
+	{ 0, UNSUPPORTED },
+	{ makeKey("mp3"), MP3 },
+	{ makeKey("bmp"), BMP },
+	{ makeKey("wav"), WAV },
+	{ 0, UNSUPPORTED },
+	{ 0, UNSUPPORTED },
+	{ makeKey("ogg"), OGG },
+	{ makeKey("png"), PNG },
+	{ makeKey("jpg"), JPG },
+	{ makeKey("gif"), GIF },
+	{ makeKey("txt"), TXT }
+};
+
+constexpr bool isPerfect (int i = 0)
+{
+	return i == TABLE_SIZE || ((TABLE[i].key == 0 || slot(TABLE[i].key) == i) && isPerfect(i + 1));
+}
+
+static_assert(isPerfect(), "every extension must sit in the slot its key hashes to");
+}
+
+inline unsigned int codeOf (QChar c)
 {
-	int index = type.lastIndexOf(".");
+	return c.unicode();
+}
+
+inline unsigned int codeOf (char c)
+{
+	return (unsigned char) c;
+}
+
+// looks up the extension of a UTF-16 or UTF-8 path, any non-ASCII unit makes it unsupported
+template <typename Char>
+inline Type getType (const Char* path, int size)
+{
+	int index = size - 1;
+	while (index >= 0 && codeOf(path[index]) != '.') {
+		--index;
+	}
 	if (index < 0) return BIN;
 
-	const char* ext = type.toLower().mid(index + 1).toStdString().c_str();
+	const int length = size - index - 1;
+	if (length < 1 || length > 4) return UNSUPPORTED;
 
-	if (strcmp(ext, "png") == 0) return PNG;
-	else if (strcmp(ext, "jpg") == 0) return JPG;
-	else if (strcmp(ext, "gif") == 0) return GIF;
-	else if (strcmp(ext, "bmp") == 0) return BMP;
-	else if (strcmp(ext, "wav") == 0) return WAV;
-	else if (strcmp(ext, "mp3") == 0) return MP3;
-	else if (strcmp(ext, "ogg") == 0) return OGG;
-	else if (strcmp(ext, "swf") == 0) return SWF;
-	else if (strcmp(ext, "xml") == 0) return XML;
-	else if (strcmp(ext, "txt") == 0) return TXT;
-	else if (strcmp(ext, "json") == 0) return JSON;
-	else if (strcmp(ext, "exe") == 0) return BIN;
+	const Char* ext = path + index + 1;
+	unsigned int key = 0;
+	for (int i = 0; i < length; ++i) {
+		unsigned int c = codeOf(ext[i]);
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		} else if (c == 0 || c > 0x7f) {
+			return UNSUPPORTED;
+		}
+		key |= c << (8 * i);
+	}
 
-	return UNSUPPORTED;
+	const Registry::Extension& entry = Registry::TABLE[Registry::slot(key)];
+	return entry.key == key ? entry.type : UNSUPPORTED;
 }
+
+inline Type getType (const QString& type)
+{
+	return getType(type.constData(), type.length());
+}
+
+inline Type getType (const QByteArray& type)
+{
+	return getType(type.constData(), type.size());
+}
+
+/**
+ * Reads the first bytes of path and returns the type its magic number identifies. Falls back to
+ * the given type when the file is not readable or the content has no known signature.
+ */
+Type sniffType (const QString& path, Type fallback);
 }
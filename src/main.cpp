@@ -97,6 +97,27 @@ int main (int argc, char** argv)
 	a.setFlexHome(flexDir);
 	a.setDebug(cmd.isDebug());
 	a.setSWC(cmd.isSWC());
+	a.setJobs(cmd.getJobs());
+	a.setWatch(cmd.isWatch());
+	a.setRescan(cmd.isRescan());
+	a.setSniff(cmd.isSniff());
+	a.setConsolidate(cmd.isConsolidate());
+	a.setKeepWorkspace(cmd.isKeepWorkspace());
+	a.setReproducible(cmd.isReproducible());
+	if (cmd.getMovieclipPattern())
+		a.setMovieclipPattern(QString(cmd.getMovieclipPattern()));
+	if (cmd.getSpritePattern())
+		a.setSpritePattern(QString(cmd.getSpritePattern()));
+	if (cmd.getSuffixPattern())
+		a.setSuffixPattern(QString(cmd.getSuffixPattern()));
+	if (cmd.getTemplateDir()) {
+		QDir templates(QString(cmd.getTemplateDir()));
+		if (!templates.exists()) {
+			System.exit("template directory \'" + templates.path() + "\' does not exist", EXIT_FAILURE);
+		}
+		templates.makeAbsolute();
+		a.setTemplateDir(templates);
+	}
 	dir.makeAbsolute();
 
 	if (!dir.exists()) {
@@ -132,6 +153,10 @@ int main (int argc, char** argv)
 
 	a.compile(dir, c);
 
+	if (cmd.isWatch() && a.watch(dir)) {
+		return a.exec();
+	}
+
 	return EXIT_SUCCESS;
 }
 
@@ -27,63 +27,58 @@
  */
 
 #include "AbstractAssetsParser.h"
+#include "common/AllocationCounter.h"
 #include "common/Logger.h"
 #include "common/Version.h"
 #include "constants/Content.h"
+#include "constants/EmbedTraits.h"
 
+#include <algorithm>
 #include <string.h>
 
 #include <QDateTime>
-#include <QFile>
-#include <QRegExp>
 
 namespace {
-const QString VAR_WIDTH = "${width}";
-const QString VAR_HEIGHT = "${height}";
-const QString VAR_BGCOLOR = "${bgcolor}";
-const QString VAR_FPS = "${fps}";
-const QString VAR_NAME = "${name}";
-const QString VAR_PATH = "${path}";
-const QString VAR_MIME = "${mime}";
-const QString VAR_LOOP1 = "${loop1}";
-const QString VAR_LOOP2 = "${loop2}";
-const QString VAR_COUNT = "${count}";
-const QString VAR_X = "${x}";
-const QString VAR_Y = "${y}";
-const QString VAR_ALPHA = "${alpha}";
-const QString VAR_VISIBLE = "${visible}";
-const QString VAR_ARRAYTYPE = "${arraytype}";
+const char* const STR_TRUE = "true";
+const char* const STR_ONE = "1";
+const char* const STR_ZERO = "0";
 
-const QString STR_TRUE = "true";
+const QString DATE_FORMAT = "yyyy-MM-dd hh:mm:ss 'UTC'";
 
-QRegExp REGEXP_VARIABLE("\\$\\{.+\\}");
+typedef std::pair<QString, QByteArray> SortKey;
+
+bool isKeyLess (const SortKey& a, const SortKey& b)
+{
+	return a.first < b.first;
+}
 
-const size_t MEMORY = 24;
 }
 
 AbstractAssetsParser::AbstractAssetsParser () :
 	_targetDir(),
 	_tempDir(),
+	_compileList(),
+	_jobs(1),
 	_fileHeader("//\n// "),
-	_memAllocator(MEMORY),
-	_templateList(),
-	_compileList()
+	_templateCache(),
+	_writer(),
+	_lock(),
+	_embeds(),
+	_holders(),
+	_mainTemplate(NULL),
+	_renderAllocations(0)
 {
-	REGEXP_VARIABLE.setMinimal(true);
-
 	_withsp = false;
 	_withmc = false;
 	_useVector = true;
+	_sniffTypes = false;
+	_consolidate = false;
+	_reproducible = false;
+	std::fill(_templates, _templates + CLASSES, static_cast<const Template*>(NULL));
 }
 
 AbstractAssetsParser::~AbstractAssetsParser ()
 {
-	for (TemplateListIter i = _templateList.begin(); i != _templateList.end(); ++i) {
-		debug("closing read stream " + i->first);
-		QFile* readable = i->second;
-		readable->close();
-		delete readable;
-	}
 }
 
 void AbstractAssetsParser::setTargetDir (const QDir& dir)
@@ -94,6 +89,8 @@ void AbstractAssetsParser::setTargetDir (const QDir& dir)
 void AbstractAssetsParser::setTempDir (const QDir& dir)
 {
 	_tempDir = dir;
+	// resolve the cached absolute path before the directory is shared between threads
+	_tempDir.absolutePath();
 }
 
 void AbstractAssetsParser::setUseVector (const bool use)
@@ -101,124 +98,406 @@ void AbstractAssetsParser::setUseVector (const bool use)
 	_useVector = use;
 }
 
+void AbstractAssetsParser::setSniffTypes (const bool sniff)
+{
+	_sniffTypes = sniff;
+}
+
+void AbstractAssetsParser::setJobs (int jobs)
+{
+	_jobs = jobs < 1 ? 1 : jobs;
+}
+
+void AbstractAssetsParser::setConsolidate (const bool consolidate)
+{
+	_consolidate = consolidate;
+}
+
+void AbstractAssetsParser::setKeepWorkspace (const bool keep)
+{
+	_writer.setKeepWorkspace(keep);
+}
+
+void AbstractAssetsParser::setReproducible (const bool reproducible)
+{
+	_reproducible = reproducible;
+}
+
+void AbstractAssetsParser::setTemplateDir (const QDir& dir)
+{
+	_templateCache.setDirectory(dir);
+}
+
+// orders UTF-8 class names like QString does, normalized they do not depend on what the file system returned
+void AbstractAssetsParser::sortClasses (CompileList& names, bool normalized)
+{
+	std::vector<SortKey> keys;
+	keys.reserve(names.size());
+	for (CompileListConstIter i = names.begin(); i != names.end(); ++i) {
+		const QString key = QString::fromUtf8(*i);
+		keys.push_back(SortKey(normalized ? key.normalized(QString::NormalizationForm_C) : key, *i));
+	}
+	std::stable_sort(keys.begin(), keys.end(), isKeyLess);
+	for (size_t i = 0; i < keys.size(); ++i) {
+		names[i] = keys[i].second;
+	}
+}
+
+int AbstractAssetsParser::getWriterCount () const
+{
+	return std::min(_jobs, int(MAX_WRITERS));
+}
+
+void AbstractAssetsParser::removeStaleFiles () const
+{
+	_writer.removeStale(_tempDir);
+}
+
+// an incremental update only writes what changed, every class still generated is kept
+void AbstractAssetsParser::retainClassFiles () const
+{
+	for (CompileListConstIter i = _compileList.begin(); i != _compileList.end(); ++i) {
+		if (!_consolidate || !_embeds.contains(*i)) {
+			_writer.retain(getClassFilePath(*i));
+		}
+	}
+	for (CompileListConstIter i = _holders.begin(); i != _holders.end(); ++i) {
+		_writer.retain(getClassFilePath(*i));
+	}
+	_writer.retain(_tempDir.absoluteFilePath(Content::STR_MAIN + Content::STR_DOT_AS));
+	if (_withsp) {
+		_writer.retain(_tempDir.absoluteFilePath(Content::STR_EXTSPRITE + Content::STR_DOT_AS));
+	}
+	if (_withmc) {
+		_writer.retain(_tempDir.absoluteFilePath(Content::STR_EXTMOVIECLIP + Content::STR_DOT_AS));
+	}
+}
+
 void AbstractAssetsParser::init ()
 {
 	_fileHeader.append(APPFULLNAME);
 	_fileHeader.append("\n// ");
 	_fileHeader.append(COPYRIGHT);
-	_fileHeader.append("\n//\n// Automatically generated on ");
-	_fileHeader.append(QDateTime::currentDateTime().toString());
+	_fileHeader.append("\n//\n// Automatically generated");
+	QString date;
+	if (!_reproducible) {
+		date = " on " + QDateTime::currentDateTime().toString();
+	} else if (qEnvironmentVariableIsSet("SOURCE_DATE_EPOCH")) {
+		bool valid = false;
+		const qint64 epoch = qgetenv("SOURCE_DATE_EPOCH").toLongLong(&valid);
+		if (valid) {
+			date = " on " + QDateTime::fromMSecsSinceEpoch(epoch * 1000).toUTC().toString(::DATE_FORMAT);
+		} else {
+			warning("ignoring invalid SOURCE_DATE_EPOCH");
+		}
+	}
+	_fileHeader.append(date);
 	_fileHeader.append("\n//\n\n");
+	_writer.setHeader(_fileHeader, date);
+
+	// resolved once so rendering an asset does not build template names
+	for (int i = 0; i < CLASSES; ++i) {
+		_templates[i] = _templateCache.find(Content::getContentName(Content::Class(i)) + Content::STR_DOT_AS);
+	}
+	_mainTemplate = openTemplateFile(Content::STR_MAIN + Content::STR_DOT_AS);
 }
 
-QFile* AbstractAssetsParser::createEmptyFile (const QString& name) const
+const Template* AbstractAssetsParser::getClassTemplate (Content::Class clazz) const
 {
-	WriteFile* handle = new (_memAllocator) WriteFile();
-	handle->setFileName(_tempDir.absoluteFilePath(name));
-
-	if (!handle->open(QIODevice::WriteOnly)) {
-		error("failed to open file " + handle->fileName());
-		operator delete(handle, _memAllocator);
-		return NULL;
+	const Template* compiled = _templates[clazz];
+	if (!compiled) {
+		error("unknown template " + Content::getContentName(clazz) + Content::STR_DOT_AS);
 	}
-
-	handle->write(_fileHeader.toStdString().c_str());
-	return handle;
+	return compiled;
 }
 
-QFile* AbstractAssetsParser::openTemplateFile (const QString& name)
+// only called from the thread running the parser, workers get their templates through init()
+const Template* AbstractAssetsParser::openTemplateFile (const QString& name) const
 {
-	QFile* readable = NULL;
-	if ((readable = _templateList[name])) {
-		readable->seek(0);
-		return readable;
+	const Template* compiled = _templateCache.find(name);
+	if (!compiled) {
+		error("unknown template " + name);
+	}
+	return compiled;
+}
+
+/**
+ * Generation policies, one per kind of class. Each names its template, binds the values that are
+ * fixed for the whole class and expands the loop lines of its template; render() is instantiated
+ * per policy so every kind gets its own inlined path without runtime dispatch.
+ */
+struct AbstractAssetsParser::EmbedKind {
+	struct Source {
+		Content::Class clazz;
+		StringView name;
+		StringView path;
+		StringView mime;
+	};
+	static const bool LOOPS = false;
+
+	static const Template* getTemplate (const AbstractAssetsParser& parser, const Source& source)
+	{
+		return parser.getClassTemplate(source.clazz);
+	}
+
+	static void bind (const Source& source, Template::Values& values)
+	{
+		values.set(Template::PATH, source.path);
+		values.set(Template::MIME, source.mime);
+		values.set(Template::NAME, source.name);
+	}
+
+	static int getReserve (const Source& source)
+	{
+		return source.path.size() + source.mime.size() + source.name.size() * 2;
+	}
+
+	static void expand (const AbstractAssetsParser&, const Template::Line&, const Source&, QByteArray&)
+	{
+	}
+};
+
+struct AbstractAssetsParser::DisplaySource {
+	const SpriteAsset* asset;
+	// of every frame, resolved before rendering since sniffing reads the files
+	const std::vector<const char*>* mimes;
+};
+
+template <Content::Class C>
+struct AbstractAssetsParser::DisplayKind {
+	typedef DisplaySource Source;
+	static const bool LOOPS = true;
+
+	static const Template* getTemplate (const AbstractAssetsParser& parser, const Source&)
+	{
+		return parser.getClassTemplate(C);
+	}
+
+	// properties of the sprite itself are left out when they are not given
+	static void bind (const Source& source, Template::Values& values)
+	{
+		const SpriteAsset& asset = *source.asset;
+		values.set(Template::NAME, asset.name);
+		values.set(Template::X, asset.x, true);
+		values.set(Template::Y, asset.y, true);
+		values.set(Template::ALPHA, asset.alpha, true);
+		values.set(Template::VISIBLE, asset.visible, true);
+	}
+
+	static int getReserve (const Source& source)
+	{
+		return int(source.asset->assets.size()) * 192;
+	}
+
+	// ${loop1} embeds every frame, ${loop2} places it
+	static void expand (const AbstractAssetsParser&, const Template::Line& line, const Source& source, QByteArray& out)
+	{
+		const ImageList& assets = source.asset->assets;
+		Template::Values frame;
+		unsigned int count = 0;
+		for (ImageListConstIter iter = assets.begin(); iter != assets.end(); ++iter) {
+			const Decimal strcount(count);
+			frame.set(Template::COUNT, strcount.view());
+
+			if (line.loop == Template::LOOP1) {
+#ifdef __WIN32__
+				const QByteArray path = QByteArray(iter->path).replace('\\', '/');
+#else
+				const QByteArray& path = iter->path;
+#endif
+				frame.set(Template::PATH, path);
+				frame.set(Template::MIME, (*source.mimes)[count]);
+				Template::renderLine(line, frame, out);
+			} else {
+				frame.set(Template::VISIBLE, iter->visible.isEmpty() ? StringView(::STR_TRUE) : StringView(iter->visible));
+				frame.set(Template::ALPHA, iter->alpha.isEmpty() ? StringView(::STR_ONE) : StringView(iter->alpha));
+				frame.set(Template::Y, iter->y.isEmpty() ? StringView(::STR_ZERO) : StringView(iter->y));
+				frame.set(Template::X, iter->x.isEmpty() ? StringView(::STR_ZERO) : StringView(iter->x));
+				Template::renderLine(line, frame, out);
+			}
+			++count;
+		}
+	}
+};
+
+template <Content::Class C>
+struct AbstractAssetsParser::BaseKind {
+	typedef QByteArray Source;
+	static const bool LOOPS = false;
+
+	static const Template* getTemplate (const AbstractAssetsParser& parser, const Source&)
+	{
+		return parser.getClassTemplate(C);
+	}
+
+	static void bind (const Source& arrayType, Template::Values& values)
+	{
+		values.set(Template::ARRAYTYPE, arrayType);
+	}
+
+	static int getReserve (const Source& arrayType)
+	{
+		return arrayType.size() * 2;
+	}
+
+	static void expand (const AbstractAssetsParser&, const Template::Line&, const Source&, QByteArray&)
+	{
+	}
+};
+
+struct AbstractAssetsParser::MainKind {
+	struct Source {
+		const CompileList* classes;
+		StringView size;
+		StringView bgcolor;
+		StringView fps;
+	};
+	static const bool LOOPS = true;
+
+	static const Template* getTemplate (const AbstractAssetsParser& parser, const Source&)
+	{
+		return parser._mainTemplate;
+	}
+
+	static void bind (const Source& source, Template::Values& values)
+	{
+		values.set(Template::WIDTH, source.size);
+		values.set(Template::HEIGHT, source.size);
+		values.set(Template::BGCOLOR, source.bgcolor);
+		values.set(Template::FPS, source.fps);
 	}
-	readable = new QFile(name);
-	if (!readable->open(QIODevice::ReadOnly | QIODevice::Text)) {
-		error("could not open template file " + readable->fileName());
-		delete readable;
-		return NULL;
+
+	static int getReserve (const Source& source)
+	{
+		return int(source.classes->size()) * 64;
+	}
+
+	// references every generated class so the compiler picks it up
+	static void expand (const AbstractAssetsParser&, const Template::Line& line, const Source& source, QByteArray& out)
+	{
+		Template::Values values;
+		unsigned int count = 0;
+		for (CompileListConstIter i = source.classes->begin(); i != source.classes->end(); ++i) {
+			const Decimal strcount(count++);
+			values.set(Template::COUNT, strcount.view());
+			values.set(Template::NAME, *i);
+			Template::renderLine(line, values, out);
+		}
+	}
+};
+
+struct AbstractAssetsParser::HolderKind {
+	struct Source {
+		const QByteArray* name;
+		const CompileList* embeds;
+	};
+	static const bool LOOPS = true;
+
+	static const Template* getTemplate (const AbstractAssetsParser& parser, const Source&)
+	{
+		return parser.getClassTemplate(Content::HOLDER);
 	}
-	debug("open read stream " + name);
-	return _templateList[name] = readable;
+
+	static void bind (const Source& source, Template::Values& values)
+	{
+		values.set(Template::NAME, *source.name);
+	}
+
+	static int getReserve (const Source& source)
+	{
+		return int(source.embeds->size()) * 160;
+	}
+
+	static void expand (const AbstractAssetsParser& parser, const Template::Line& line, const Source& source, QByteArray& out)
+	{
+		Template::Values embed;
+		for (CompileListConstIter i = source.embeds->begin(); i != source.embeds->end(); ++i) {
+			const Embed& found = *parser._embeds.constFind(*i);
+			embed.set(Template::NAME, *i);
+			embed.set(Template::PATH, found.path);
+			embed.set(Template::MIME, found.mime);
+			Template::renderLine(line, embed, out);
+		}
+	}
+};
+
+namespace {
+template <class Source>
+struct Expansion {
+	const AbstractAssetsParser* parser;
+	const Source* source;
+};
 }
 
-void AbstractAssetsParser::createMainClass ()
+template <class Kind>
+void AbstractAssetsParser::expandLine (const void* context, const Template::Line& line, QByteArray& out)
 {
-	const QString name = Content::STR_MAIN + Content::STR_DOT_AS;
-	QFile* readable = NULL;
-	QFile* writable = NULL;
+	const Expansion<typename Kind::Source>& expansion = *static_cast<const Expansion<typename Kind::Source>*>(context);
+	Kind::expand(*expansion.parser, line, *expansion.source, out);
+}
 
-	if (!(readable = openTemplateFile(":" + name)) || !(writable = createEmptyFile(name))) {
-		return;
+// everything up to the write is counted by AllocationCounter, it reads zero in a regular build
+template <class Kind>
+bool AbstractAssetsParser::render (const QString& fileName, const typename Kind::Source& source)
+{
+	const unsigned long allocations = AllocationCounter::get();
+	const Template* readable = Kind::getTemplate(*this, source);
+	if (!readable) {
+		return false;
 	}
 
+	Template::Values values;
+	Kind::bind(source, values);
+
+	QByteArray& out = _writer.getBuffer();
+	out.reserve(readable->getSize() + Kind::getReserve(source));
+	const Expansion<typename Kind::Source> expansion = { this, &source };
+	readable->render(values, Kind::LOOPS ? &expandLine<Kind> : NULL, &expansion, out);
+	_renderAllocations += AllocationCounter::get() - allocations;
+	return _writer.write(fileName, out);
+}
+
+void AbstractAssetsParser::createMainClass ()
+{
 	info("created " + QString::number(_compileList.size()) + " asset files");
-	info("creating main class: " + name);
 
-	std::map<QString, const QString*> varmap;
-	const QString size = "1";
-	const QString bgcolor = "#ffffff";
-	const QString fps = "24";
-	const QString loop = "";
-
-	varmap[::VAR_WIDTH] = &size;
-	varmap[::VAR_HEIGHT] = &size;
-	varmap[::VAR_BGCOLOR] = &bgcolor;
-	varmap[::VAR_FPS] = &fps;
-	varmap[::VAR_LOOP1] = &loop;
-
-	while (!readable->atEnd()) {
-		QString line = readable->readLine();
-		int offset = 0;
-		int idx;
-
-		while ((idx = REGEXP_VARIABLE.indexIn(line, offset)) > -1) {
-			const int len = REGEXP_VARIABLE.matchedLength();
-			const QString var = line.mid(idx, len);
-			const QString* value = varmap[var];
-			if (value) {
-				line.remove(idx, len);
-				line.insert(idx, *value);
-				offset = idx + value->length();
-			} else {
-				warning("undefined variable " + var);
-				offset = idx + len;
-				continue;
-			}
+	CompileList classes(_compileList);
+	if (_reproducible) {
+		sortClasses(classes, true);
+	}
 
-			if (var == ::VAR_LOOP1) {
-				int ix;
-				int offsetCount = 0;
-				int offsetName = 0;
-				offset = 0;
-
-				while ((ix = REGEXP_VARIABLE.indexIn(line, offset)) > -1) {
-					const int len = REGEXP_VARIABLE.matchedLength();
-					const QString subvar = line.mid(ix, len);
-					line.remove(ix, len);
-					if (subvar == ::VAR_COUNT) {
-						offsetCount = ix;
-					} else {
-						offsetName = ix;
-					}
-				}
-
-				int count = 0;
-				for (CompileListConstIter i = _compileList.begin(); i != _compileList.end(); ++i) {
-					QString loopLine(line);
-					QString strcount = QString::number(count++);
-					loopLine.insert(offsetCount, strcount);
-					loopLine.insert(offsetName + strcount.length(), *i);
-					writable->write(loopLine.toStdString().c_str(), loopLine.length());
-				}
-				line.truncate(0);
+	// consolidated embeds are compiled through their holders, Main only references the holders
+	_holders.clear();
+	if (_consolidate) {
+		CompileList embeds;
+		CompileList referenced;
+		for (CompileListConstIter i = classes.begin(); i != classes.end(); ++i) {
+			if (_embeds.contains(*i)) {
+				embeds.push_back(*i);
+			} else {
+				referenced.push_back(*i);
 			}
 		}
-		writable->write(line.toStdString().c_str(), line.length());
+		const QByteArray prefix = getHolderPrefix(classes);
+		for (size_t first = 0; first < embeds.size(); first += HOLDER_SIZE) {
+			const size_t last = std::min(first + HOLDER_SIZE, embeds.size());
+			const QByteArray holder = prefix + QByteArray::number(int(first / HOLDER_SIZE));
+			createHolderClass(holder, CompileList(embeds.begin() + first, embeds.begin() + last));
+			_holders.push_back(holder);
+		}
+		referenced.insert(referenced.end(), _holders.begin(), _holders.end());
+		classes.swap(referenced);
 	}
-	writable->close();
-	operator delete(static_cast<WriteFile*> (writable), _memAllocator);
+
+	const QString name = Content::STR_MAIN + Content::STR_DOT_AS;
+	info("creating main class: " + name);
+
+	MainKind::Source main;
+	main.classes = &classes;
+	main.size = "1";
+	main.bgcolor = "#ffffff";
+	main.fps = "24";
+	render<MainKind>(_tempDir.absoluteFilePath(name), main);
 
 	if (_withsp)
 		createExtSpriteClass(Content::EXTSPRITE);
@@ -230,280 +509,155 @@ void AbstractAssetsParser::createMainClass ()
 void AbstractAssetsParser::createExtSpriteClass (Content::Class clazz)
 {
 	const QString name = Content::getContentName(clazz) + Content::STR_DOT_AS;
-	QFile* readable = NULL;
-	QFile* writable = NULL;
+	info("creating base class: " + name);
 
-	if (!(readable = openTemplateFile(":" + name)) || !(writable = createEmptyFile(name))) {
-		return;
+	const QByteArray arrayType = _useVector ? "Vector.<DisplayObject>" : "Array";
+	const QString fileName = _tempDir.absoluteFilePath(name);
+	if (clazz == Content::EXTMOVIECLIP) {
+		render<BaseKind<Content::EXTMOVIECLIP> >(fileName, arrayType);
+	} else {
+		render<BaseKind<Content::EXTSPRITE> >(fileName, arrayType);
 	}
+}
 
-	info("creating base class: " + name);
+bool AbstractAssetsParser::createHolderClass (const QByteArray& name, const CompileList& embeds)
+{
+	const QString fileName = getClassFilePath(name);
+	info("creating: " + fileName + " holding " + QString::number(embeds.size()) + " embeds");
 
-	int found = 0;
-	int replace = 2;
-	const QString arrayType = _useVector ? "Vector.<DisplayObject>" : "Array";
-	static std::map<QString, const QString*> varmap;
-
-	varmap[::VAR_ARRAYTYPE] = &arrayType;
-
-	while (!readable->atEnd()) {
-		QString line = readable->readLine();
-		int offset = 0;
-		int idx;
-
-		const bool parse = found < replace && clazz != Content::EXTSPRITE;
-		while (parse && (idx = REGEXP_VARIABLE.indexIn(line, offset)) > -1) {
-			const int len = REGEXP_VARIABLE.matchedLength();
-			const QString var = line.mid(idx, len);
-			const QString* value = varmap[var];
-			if (value) {
-				line.remove(idx, len);
-				line.insert(idx, *value);
-				offset = idx + value->length();
-				++found;
-			} else {
-				warning("undefined variable " + var);
-				offset = idx + len;
-			}
+	HolderKind::Source holder;
+	holder.name = &name;
+	holder.embeds = &embeds;
+	return render<HolderKind>(fileName, holder);
+}
+
+// holder classes and the classes mxmlc generates for their embeds must not clash with an asset name
+QByteArray AbstractAssetsParser::getHolderPrefix (const CompileList& classes)
+{
+	QByteArray prefix = Content::STR_HOLDER.toUtf8();
+	CompileListConstIter i = classes.begin();
+	while (i != classes.end()) {
+		if (i->startsWith(prefix)) {
+			prefix.append('_');
+			i = classes.begin();
+		} else {
+			++i;
 		}
-		writable->write(line.toStdString().c_str(), line.length());
 	}
-	writable->close();
-	operator delete(static_cast<WriteFile*> (writable), _memAllocator);
+	return prefix;
 }
 
-void AbstractAssetsParser::createFileCommon (const QString& name, const QString& path)
+bool AbstractAssetsParser::createFileCommon (const QByteArray& name, const QByteArray& path)
 {
-	File::Type type = File::getType(path);
+	const File::Type type = getFileType(path);
 	if (type == File::UNSUPPORTED) {
-		warning("unsupported file type: " + path);
-		return;
-	}
-
-	const QString baseName = Content::getContentName(getClassType(type));
-	QFile* readable = openTemplateFile(":" + baseName + Content::STR_DOT_AS);
-	if (!readable) {
-		return;
+		warning("unsupported file type: " + QString::fromUtf8(path));
+		return false;
 	}
 
-	QFile* writable = createEmptyFile(name + Content::STR_DOT_AS);
-	if (writable == NULL) {
-		return;
-	}
-
-	info("creating: " + writable->fileName() + " of type \'" + baseName + "\'");
-	_compileList.push_back(name);
-
-	static std::map<QString, const QString*> varmap;
-	const QString mime = getMimeType(type);
-
+	const char* mime = getMimeType(type);
 #ifdef __WIN32__
-	QString npath = QString(path).replace("\\", "/");
-	varmap[::VAR_PATH] = &npath;
+	const QByteArray npath = QByteArray(path).replace('\\', '/');
 #else
-	varmap[::VAR_PATH] = &path;
+	const QByteArray& npath = path;
 #endif
-	varmap[::VAR_MIME] = &mime;
-	varmap[::VAR_NAME] = &name;
-
-	while (!readable->atEnd()) {
-		QString line = readable->readLine();
-		int offset = 0;
-		int idx;
-
-		while ((idx = REGEXP_VARIABLE.indexIn(line, offset)) > -1) {
-			const int len = REGEXP_VARIABLE.matchedLength();
-			const QString var = line.mid(idx, len);
-			const QString* value = varmap[var];
-			if (value) {
-				line.remove(idx, len);
-				line.insert(idx, *value);
-				offset = idx + value->length();
-			} else {
-				warning("undefined variable " + var);
-				offset = idx + len;
-			}
-		}
-		writable->write(line.toStdString().c_str(), line.length());
+
+	if (_consolidate) {
+		Embed embed;
+		embed.path = npath;
+		embed.mime = mime;
+		debug("embedding: " + QString::fromUtf8(name) + " in a holder class");
+		std::lock_guard<std::mutex> guard(_lock);
+		_embeds.insert(name, embed);
+		return true;
 	}
-	writable->close();
-	operator delete(static_cast<WriteFile*> (writable), _memAllocator);
+
+	EmbedKind::Source source;
+	source.clazz = getClassType(type);
+	source.name = name;
+	source.path = npath;
+	source.mime = mime;
+
+	const QString fileName = getClassFilePath(name);
+	info("creating: " + fileName + " of type \'" + Content::getContentName(source.clazz) + "\'");
+	return render<EmbedKind>(fileName, source);
 }
 
-void AbstractAssetsParser::createFileSprite (const SpriteAsset* asset)
+bool AbstractAssetsParser::createFileSprite (const SpriteAsset* asset)
 {
-	ImageList imageList = asset->assets;
-	const QString name = asset->name;
-	const QString baseName = Content::getContentName(asset->clazz);
+	const QByteArray& name = asset->name;
+	const QString fileName = getClassFilePath(name);
+	info("creating: " + fileName + " of type \'" + Content::getContentName(asset->clazz) + "\'");
 
-	QFile* readable = openTemplateFile(":" + baseName + Content::STR_DOT_AS);
-	if (!readable) {
-		return;
-	}
+	const bool ismc = asset->clazz == Content::MOVIECLIP;
 
-	QFile* writable = createEmptyFile(name + Content::STR_DOT_AS);
-	if (writable == NULL) {
-		return;
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_withmc |= ismc;
+		_withsp |= !ismc;
 	}
 
-	info("creating: " + writable->fileName() + " of type \'" + baseName + "\'");
-
-	const bool ismc = asset->clazz == Content::MOVIECLIP;
-
-	_compileList.push_back(name);
-	_withmc |= ismc;
-	_withsp |= !ismc;
-
-	while (!readable->atEnd()) {
-		QString line = readable->readLine();
-		int offset = 0;
-		int mi;
-
-		while ((mi = REGEXP_VARIABLE.indexIn(line, offset)) > -1) {
-			const int len = REGEXP_VARIABLE.matchedLength();
-			const QString var = line.mid(mi, len);
-			line.remove(mi, len);
-
-			if (var == ::VAR_NAME) {
-				line.insert(mi, name);
-				offset = mi + name.length();
-			} else if (var == ::VAR_LOOP1) {
-				int ix;
-				int offsetPath = 0;
-				int offsetMime = 0;
-				int offsetCount = 0;
-				offset = 0;
-
-				while ((ix = REGEXP_VARIABLE.indexIn(line, offset)) > -1) {
-					const int len = REGEXP_VARIABLE.matchedLength();
-					const QString subvar = line.mid(ix, len);
-					line.remove(ix, len);
-					if (subvar == ::VAR_PATH) {
-						offsetPath = ix;
-					} else if (subvar == ::VAR_MIME) {
-						offsetMime = ix;
-					} else {
-						offsetCount = ix;
-					}
-				}
-
-				int count = 0;
-				for (ImageListConstIter iter = imageList.begin(); iter != imageList.end(); ++iter) {
-					AssetBit asset = *iter;
+	// keeps its capacity from one sprite of the thread to the next
+	static thread_local std::vector<const char*> mimes;
+	mimes.clear();
+	for (ImageListConstIter i = asset->assets.begin(); i != asset->assets.end(); ++i) {
 #ifdef __WIN32__
-					QString path = asset.path.replace("\\", "/");
+		mimes.push_back(getMimeType(getFileType(QByteArray(i->path).replace('\\', '/'))));
 #else
-					QString path(asset.path);
+		mimes.push_back(getMimeType(getFileType(i->path)));
 #endif
-					QString loopLine = QString(line);
-					const QString mime = getMimeType(File::getType(path));
-					loopLine.insert(offsetPath, path);
-					loopLine.insert(offsetMime + path.length(), mime);
-					loopLine.insert(offsetCount + path.length() + mime.length(), QString::number(count++));
-					writable->write(loopLine.toStdString().c_str(), loopLine.length());
-				}
-				line.truncate(0);
-			} else if (var == ::VAR_LOOP2) {
-				int ix;
-				int offsetCount = 0;
-				offset = 0;
-
-				while ((ix = REGEXP_VARIABLE.indexIn(line, offset)) > -1) {
-					const int len = REGEXP_VARIABLE.matchedLength();
-					const QString subvar = line.mid(ix, len);
-					line.remove(ix, len);
-					if (subvar == ::VAR_COUNT) {
-						offsetCount = ix;
-						offset = name.length();
-						break;
-					}
-				}
-
-				int count = 0;
-				for (ImageListConstIter iter = imageList.begin(); iter != imageList.end(); ++iter) {
-					AssetBit asset = *iter;
-					QString loopLine = QString(line);
-					loopLine.insert(offsetCount, QString::number(count++));
-					loopLine.replace(::VAR_VISIBLE, asset.visible.isEmpty() ? ::STR_TRUE : asset.visible);
-					loopLine.replace(::VAR_ALPHA, asset.alpha.isEmpty() ? QString::number(1.0) : asset.alpha);
-					loopLine.replace(::VAR_Y, asset.y.isEmpty() ? QString::number(0) : asset.y);
-					loopLine.replace(::VAR_X, asset.x.isEmpty() ? QString::number(0) : asset.x);
-					writable->write(loopLine.toStdString().c_str(), loopLine.length());
-				}
-				line.truncate(0);
-			} else if (var == ::VAR_X) {
-				replaceProperty(asset->x, line, mi, &offset);
-			} else if (var == ::VAR_Y) {
-				replaceProperty(asset->y, line, mi, &offset);
-			} else if (var == ::VAR_ALPHA) {
-				replaceProperty(asset->alpha, line, mi, &offset);
-			} else if (var == ::VAR_VISIBLE) {
-				replaceProperty(asset->visible, line, mi, &offset);
-			}
-		}
-		writable->write(line.toStdString().c_str(), line.length());
 	}
 
-	writable->close();
-	operator delete(static_cast<WriteFile*> (writable), _memAllocator);
+	DisplaySource source;
+	source.asset = asset;
+	source.mimes = &mimes;
+	if (ismc) {
+		return render<DisplayKind<Content::MOVIECLIP> >(fileName, source);
+	}
+	return render<DisplayKind<Content::SPRITE> >(fileName, source);
 }
 
-void AbstractAssetsParser::replaceProperty (const QString& variable, QString& line, int index, int* offset) const
+unsigned long AbstractAssetsParser::getRenderAllocations () const
 {
-	if (variable.isEmpty()) {
-		line.truncate(0);
-	} else {
-		line.insert(index, variable);
-		*offset = index + variable.length();
+	return _renderAllocations;
+}
+
+bool AbstractAssetsParser::isConsolidate () const
+{
+	return _consolidate;
+}
+
+// called before a name is generated again, never while workers generate
+void AbstractAssetsParser::forgetEmbed (const QByteArray& name)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	_embeds.remove(name);
+}
+
+File::Type AbstractAssetsParser::getFileType (const QByteArray& path) const
+{
+	const File::Type type = File::getType(path);
+	if (!_sniffTypes || type == File::UNSUPPORTED) {
+		return type;
 	}
+	return File::sniffType(_tempDir.absoluteFilePath(QString::fromUtf8(path)), type);
 }
 
 Content::Class AbstractAssetsParser::getClassType (const File::Type type) const
 {
-	switch (type) {
-	case File::PNG:
-	case File::JPG:
-	case File::GIF:
-		return Content::BITMAPDATA;
-	case File::BMP:
-	case File::WAV:
-	case File::OGG:
-	case File::SWF:
-	case File::XML:
-	case File::TXT:
-	case File::JSON:
-	case File::BIN:
-		return Content::BYTEARRAY;
-	case File::MP3:
-		return Content::SOUND;
-	case File::UNSUPPORTED:
-	default:
-		return Content::UNDEFINED;
-	}
-}
-
-QString AbstractAssetsParser::getMimeType (const File::Type type) const
-{
-	switch (type) {
-	case File::PNG:
-		return "image/png";
-	case File::JPG:
-		return "image/jpg";
-	case File::GIF:
-		return "image/gif";
-	case File::MP3:
-		return "audio/mpeg";
-	case File::UNSUPPORTED:
+	return ::Embed::getInfo(type).clazz;
+}
+
+const char* AbstractAssetsParser::getMimeType (const File::Type type) const
+{
+	if (type == File::UNSUPPORTED) {
 		warning("unsupported file type");
-	case File::BMP:
-	case File::WAV:
-	case File::OGG:
-	case File::SWF:
-	case File::XML:
-	case File::TXT:
-	case File::JSON:
-	case File::BIN:
-	default:
-		return "application/octet-stream";
 	}
+	return ::Embed::getInfo(type).mime;
+}
+
+// the file system boundary, class names only turn back into a QString for the file name
+QString AbstractAssetsParser::getClassFilePath (const QByteArray& name) const
+{
+	return _tempDir.absoluteFilePath(QString::fromUtf8(name) + Content::STR_DOT_AS);
 }
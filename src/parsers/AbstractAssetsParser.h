@@ -28,16 +28,21 @@
 
 #pragma once
 
-#include "common/MemoryAllocator.h"
+#include "OutputWriter.h"
+#include "Template.h"
+#include "TemplateCache.h"
 #include "constants/FileType.h"
 #include "constants/Content.h"
 
-#include <map>
+#include <atomic>
+#include <mutex>
 #include <vector>
 
+#include <QByteArray>
 #include <QDir>
-#include <QFile>
+#include <QHash>
 #include <QString>
+#include <QStringList>
 
 class AbstractAssetsParser {
 public:
@@ -48,16 +53,36 @@ public:
 	void setTargetDir (const QDir& dir);
 	void setTempDir (const QDir& dir);
 	void setUseVector (const bool use);
+	void setSniffTypes (const bool sniff);
+	void setJobs (int jobs);
+	void setConsolidate (const bool consolidate);
+	void setKeepWorkspace (const bool keep);
+	void setReproducible (const bool reproducible);
+	void setTemplateDir (const QDir& dir);
 	void init ();
 
 protected:
+	// number of threads that may render and write class files at the same time
+	static const int MAX_WRITERS = 64;
+	// embeds per holder class when bitmaps, sounds and binaries are consolidated
+	static const int HOLDER_SIZE = 1000;
+	static const int CLASSES = Content::HOLDER + 1;
+
+	// UTF-8 from here on, converted once when the scanners hand an asset over
 	struct AssetBit {
-		QString name;
-		QString path;
-		QString x;
-		QString y;
-		QString alpha;
-		QString visible;
+		QByteArray name;
+		QByteArray path;
+		QByteArray x;
+		QByteArray y;
+		QByteArray alpha;
+		QByteArray visible;
+
+		// the virtual destructor would otherwise suppress the implicit moves
+		AssetBit () = default;
+		AssetBit (const AssetBit&) = default;
+		AssetBit (AssetBit&&) = default;
+		AssetBit& operator= (const AssetBit&) = default;
+		AssetBit& operator= (AssetBit&&) = default;
 		virtual ~AssetBit ()
 		{
 		}
@@ -77,41 +102,73 @@ protected:
 		ImageList assets;
 	};
 
-	typedef std::map<QString, QFile*> TemplateList;
-	typedef TemplateList::iterator TemplateListIter;
-
-	typedef std::vector<QString> CompileList;
+	typedef std::vector<QByteArray> CompileList;
 	typedef CompileList::const_iterator CompileListConstIter;
 
-	typedef class WriteFile: public IMemoryAllocationObject, public QFile {
-		size_t msize () const
-		{
-			return sizeof(*this);
-		}
-	} WriteFile;
-
-	QFile* createEmptyFile (const QString& name) const;
-	QFile* openTemplateFile (const QString& name);
+	const Template* openTemplateFile (const QString& name) const;
+	const Template* getClassTemplate (Content::Class clazz) const;
 
 	void createMainClass ();
 	void createExtSpriteClass (Content::Class clazz);
-	void createFileCommon (const QString& name, const QString& path);
-	void createFileSprite (const SpriteAsset* asset);
-
-	inline Content::Class getClassType (const File::Type type) const;
-	inline QString getMimeType (const File::Type type) const;
+	bool createFileCommon (const QByteArray& name, const QByteArray& path);
+	bool createFileSprite (const SpriteAsset* asset);
+	void forgetEmbed (const QByteArray& name);
+	bool isConsolidate () const;
+	// heap allocations made while rendering classes, see AllocationCounter
+	unsigned long getRenderAllocations () const;
+
+	File::Type getFileType (const QByteArray& path) const;
+	Content::Class getClassType (const File::Type type) const;
+	const char* getMimeType (const File::Type type) const;
+	QString getClassFilePath (const QByteArray& name) const;
+
+	static void sortClasses (CompileList& names, bool normalized);
+	int getWriterCount () const;
+	void removeStaleFiles () const;
+	void retainClassFiles () const;
 
 	QDir _targetDir;
 	QDir _tempDir;
+	CompileList _compileList;
+	int _jobs;
 
 private:
-	void replaceProperty (const QString& variable, QString& line, int index, int* offset) const;
+	struct Embed {
+		QByteArray path;
+		const char* mime;
+	};
+	typedef QHash<QByteArray, Embed> EmbedIndex;
+
+	// generation policies, defined next to render() which is instantiated once per kind
+	struct DisplaySource;
+	struct EmbedKind;
+	template <Content::Class C> struct DisplayKind;
+	template <Content::Class C> struct BaseKind;
+	struct MainKind;
+	struct HolderKind;
+
+	template <class Kind>
+	bool render (const QString& fileName, const typename Kind::Source& source);
+	// Template::Expander of a kind, context is an Expansion
+	template <class Kind>
+	static void expandLine (const void* context, const Template::Line& line, QByteArray& out);
+
+	bool createHolderClass (const QByteArray& name, const CompileList& embeds);
+	static QByteArray getHolderPrefix (const CompileList& classes);
 
 	QString _fileHeader;
-	mutable MemoryAllocator _memAllocator;
-	TemplateList _templateList;
-	CompileList _compileList;
+	const Template* _templates[CLASSES];
+	mutable TemplateCache _templateCache;
+	OutputWriter _writer;
+	mutable std::mutex _lock;
+	EmbedIndex _embeds;
+	CompileList _holders;
+	const Template* _mainTemplate;
+	std::atomic<unsigned long> _renderAllocations;
 	bool _withsp;
 	bool _withmc;
 	bool _useVector;
+	bool _sniffTypes;
+	bool _consolidate;
+	bool _reproducible;
 };
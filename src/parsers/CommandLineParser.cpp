@@ -37,12 +37,23 @@
 CommandLineParser::CommandLineParser () :
 	_target(NULL),
 	_output(NULL),
+	_movieclipPattern(NULL),
+	_spritePattern(NULL),
+	_suffixPattern(NULL),
+	_templates(NULL),
 	_player(-1),
 	_verbosity(1),
 	_quality(-1),
+	_jobs(1),
 	_mode(CompileMode::UNDEFINED),
 	_swc(false),
-	_debug(false)
+	_debug(false),
+	_watch(false),
+	_rescan(false),
+	_sniff(false),
+	_consolidate(false),
+	_keepWorkspace(false),
+	_reproducible(false)
 {
 }
 
@@ -65,12 +76,24 @@ bool CommandLineParser::parse (int argc, char* argv[])
 			{ "verbosity", 0, 0, 'v' },
 			{ "swc", 0, 0, 's' },
 			{ "debug", 0, 0, 'd' },
-			{ "player", 1, 0, 'p' }
+			{ "watch", 0, 0, 'w' },
+			{ "rescan", 0, 0, 'r' },
+			{ "sniff", 0, 0, 'F' },
+			{ "consolidate", 0, 0, 'C' },
+			{ "keep-workspace", 0, 0, 'K' },
+			{ "reproducible", 0, 0, 'R' },
+			{ "player", 1, 0, 'p' },
+			{ "jobs", 1, 0, 'j' },
+			{ "movieclip-pattern", 1, 0, 'M' },
+			{ "sprite-pattern", 1, 0, 'S' },
+			{ "suffix-pattern", 1, 0, 'X' },
+			{ "templates", 1, 0, 'T' },
+			{ 0, 0, 0, 0 }
 	};
 
 	while (1) {
 		int index = 0;
-		int c = getopt_long(argc, argv, "m:vdsq:o:", options, &index);
+		int c = getopt_long(argc, argv, "m:vdswrq:o:j:", options, &index);
 
 		if (c == -1) {
 			break;
@@ -85,6 +108,30 @@ bool CommandLineParser::parse (int argc, char* argv[])
 			++_verbosity;
 			break;
 
+		case 'w':
+			_watch = true;
+			break;
+
+		case 'r':
+			_rescan = true;
+			break;
+
+		case 'F':
+			_sniff = true;
+			break;
+
+		case 'C':
+			_consolidate = true;
+			break;
+
+		case 'K':
+			_keepWorkspace = true;
+			break;
+
+		case 'R':
+			_reproducible = true;
+			break;
+
 		case 'm': {
 			int mode = atoi(optarg);
 			if (!CompileMode::checkMode(mode)) {
@@ -118,11 +165,42 @@ bool CommandLineParser::parse (int argc, char* argv[])
 			break;
 		}
 
+		case 'j': {
+			int jobs = atoi(optarg);
+			if (jobs < 1) {
+				printf("invalid jobs %d\n", jobs);
+				return EXIT_FAILURE;
+			}
+			_jobs = jobs;
+			printf("option j with value `%i'\n", _jobs);
+			break;
+		}
+
 		case 'o':
 			_output = optarg;
 			printf("option o with value `%s'\n", _output);
 			break;
 
+		case 'M':
+			_movieclipPattern = optarg;
+			printf("option movieclip-pattern with value `%s'\n", _movieclipPattern);
+			break;
+
+		case 'S':
+			_spritePattern = optarg;
+			printf("option sprite-pattern with value `%s'\n", _spritePattern);
+			break;
+
+		case 'X':
+			_suffixPattern = optarg;
+			printf("option suffix-pattern with value `%s'\n", _suffixPattern);
+			break;
+
+		case 'T':
+			_templates = optarg;
+			printf("option templates with value `%s'\n", _templates);
+			break;
+
 		case 's':
 			_swc = true;
 			printf("option s with value `%d'\n", _swc);
@@ -132,6 +210,7 @@ bool CommandLineParser::parse (int argc, char* argv[])
 			switch (optopt) {
 			case 'm':
 			case 'q':
+			case 'j':
 			case 'o':
 				fprintf(stderr, "Option -%c requires an argument.\n", optopt);
 				break;
@@ -175,6 +254,26 @@ char* CommandLineParser::getOutput () const
 	return _output;
 }
 
+char* CommandLineParser::getMovieclipPattern () const
+{
+	return _movieclipPattern;
+}
+
+char* CommandLineParser::getSpritePattern () const
+{
+	return _spritePattern;
+}
+
+char* CommandLineParser::getSuffixPattern () const
+{
+	return _suffixPattern;
+}
+
+char* CommandLineParser::getTemplateDir () const
+{
+	return _templates;
+}
+
 float CommandLineParser::getPlayer () const
 {
 	return _player;
@@ -190,6 +289,11 @@ int CommandLineParser::getQuality () const
 	return _quality;
 }
 
+int CommandLineParser::getJobs () const
+{
+	return _jobs;
+}
+
 CompileMode::Mode CommandLineParser::getCompileMode () const
 {
 	return _mode;
@@ -204,3 +308,33 @@ bool CommandLineParser::isDebug () const
 {
 	return _debug;
 }
+
+bool CommandLineParser::isWatch () const
+{
+	return _watch;
+}
+
+bool CommandLineParser::isRescan () const
+{
+	return _rescan;
+}
+
+bool CommandLineParser::isSniff () const
+{
+	return _sniff;
+}
+
+bool CommandLineParser::isConsolidate () const
+{
+	return _consolidate;
+}
+
+bool CommandLineParser::isKeepWorkspace () const
+{
+	return _keepWorkspace;
+}
+
+bool CommandLineParser::isReproducible () const
+{
+	return _reproducible;
+}
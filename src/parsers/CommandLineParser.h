@@ -39,20 +39,42 @@ public:
 
 	char* getTargetDir () const;
 	char* getOutput () const;
+	char* getMovieclipPattern () const;
+	char* getSpritePattern () const;
+	char* getSuffixPattern () const;
+	char* getTemplateDir () const;
 	float getPlayer () const;
 	int getVerbosityLevel () const;
 	int getQuality () const;
+	int getJobs () const;
 	CompileMode::Mode getCompileMode () const;
 	bool isSWC () const;
 	bool isDebug () const;
+	bool isWatch () const;
+	bool isRescan () const;
+	bool isSniff () const;
+	bool isConsolidate () const;
+	bool isKeepWorkspace () const;
+	bool isReproducible () const;
 
 private:
 	char* _target;
 	char* _output;
+	char* _movieclipPattern;
+	char* _spritePattern;
+	char* _suffixPattern;
+	char* _templates;
 	float _player;
 	int _verbosity;
 	int _quality;
+	int _jobs;
 	CompileMode::Mode _mode;
 	bool _swc;
 	bool _debug;
+	bool _watch;
+	bool _rescan;
+	bool _sniff;
+	bool _consolidate;
+	bool _keepWorkspace;
+	bool _reproducible;
 };
@@ -0,0 +1,427 @@
+/*
+ * DefinitionCache.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "DefinitionCache.h"
+#include "common/Logger.h"
+#include "ports/System.h"
+
+#include <string.h>
+
+#include <QCryptographicHash>
+
+namespace {
+// differs when read on a machine of the other byte order, the file is then ignored
+const quint32 CACHE_MAGIC = 0x43534446;
+// bump whenever the header, a record layout or the accepted elements change
+const quint32 CACHE_VERSION = 3;
+const int HASH_SIZE = 20;
+// the empty string is interned first, absent attributes refer to it
+const quint32 EMPTY_STRING = 0;
+// chunk in which the spilled tables are copied into the file
+const qint64 COPY_SIZE = 65536;
+// unique per writer, concurrent runs of the same definition each publish a complete file
+const QString TEMP_PATTERN = ".XXXXXX";
+}
+
+// the tables follow the header in this order: elements, frames, settings and the string blob
+struct DefinitionCache::FileHeader {
+	quint32 magic;
+	quint32 version;
+	quint32 settingCount;
+	quint32 elementCount;
+	quint32 frameCount;
+	quint32 textSize;
+	char hash[HASH_SIZE];
+	quint32 reserved;
+};
+
+struct DefinitionCache::SettingRecord {
+	quint32 tag;
+	quint32 text;
+};
+
+struct DefinitionCache::ElementRecord {
+	quint32 clazz;
+	quint32 tag;
+	quint32 fields[FIELDS];
+	quint32 firstFrame;
+	quint32 frameCount;
+};
+
+struct DefinitionCache::FrameRecord {
+	quint32 tag;
+	quint32 fields[FIELDS];
+};
+
+DefinitionCache::DefinitionCache () :
+	_output(NULL),
+	_frameSpill(NULL),
+	_textSpill(NULL),
+	_path(),
+	_hash(),
+	_index(),
+	_settings(),
+	_elementCount(0),
+	_frameCount(0),
+	_textSize(0),
+	_failed(false),
+	_file(),
+	_data(NULL),
+	_header(NULL),
+	_settingTable(NULL),
+	_elementTable(NULL),
+	_frameTable(NULL),
+	_textTable(NULL)
+{
+	// every record is read in place, so none may need more than the 4 byte alignment of the mapping
+	static_assert(sizeof(FileHeader) == 48, "the header layout is part of the file format");
+	static_assert(sizeof(ElementRecord) == 4 * (FIELDS + 4), "element records are packed quint32");
+	static_assert(sizeof(FrameRecord) == 4 * (FIELDS + 1), "frame records are packed quint32");
+}
+
+DefinitionCache::~DefinitionCache ()
+{
+	discard();
+	close();
+}
+
+QByteArray DefinitionCache::hashFile (const QString& path)
+{
+	QFile file(path);
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+		return QByteArray();
+	}
+	return hash.result();
+}
+
+QString DefinitionCache::getCachePath (const QByteArray& hash)
+{
+	const QString dir = System.getHomeDir().path() + "/definitions/";
+	System.makeDir(dir);
+	return dir + hash.toHex();
+}
+
+// the header is written again with the table sizes by commit()
+bool DefinitionCache::create (const QString& path, const QByteArray& hash)
+{
+	discard();
+	if (hash.size() != HASH_SIZE) {
+		return false;
+	}
+	_path = path;
+	_hash = hash;
+	_elementCount = 0;
+	_frameCount = 0;
+	_textSize = 0;
+	_failed = false;
+	_output = new QTemporaryFile(path + TEMP_PATTERN);
+	_frameSpill = new QTemporaryFile();
+	_textSpill = new QTemporaryFile();
+	if (!_output->open() || !_frameSpill->open() || !_textSpill->open()) {
+		warning("cannot write compiled definition " + path);
+		discard();
+		return false;
+	}
+	const FileHeader header = FileHeader();
+	write(*_output, &header, sizeof(header));
+	intern(StringView("", 0));
+	return !_failed;
+}
+
+void DefinitionCache::addSetting (const QString& tag, const QString& text)
+{
+	if (!_output) {
+		return;
+	}
+	_settings.push_back(intern(tag.toUtf8()));
+	_settings.push_back(intern(text.toUtf8()));
+}
+
+void DefinitionCache::addElement (const Element& element, const Frame* frames)
+{
+	if (!_output) {
+		return;
+	}
+	FrameRecord frame;
+	for (quint32 i = 0; i < element.frameCount; ++i) {
+		frame.tag = intern(frames[i].tag);
+		for (int field = 0; field < FIELDS; ++field) {
+			frame.fields[field] = intern(frames[i].fields[field]);
+		}
+		write(*_frameSpill, &frame, sizeof(frame));
+	}
+
+	ElementRecord record;
+	record.clazz = quint32(element.clazz);
+	record.tag = intern(element.tag);
+	for (int field = 0; field < FIELDS; ++field) {
+		record.fields[field] = intern(element.fields[field]);
+	}
+	record.firstFrame = _frameCount;
+	record.frameCount = element.frameCount;
+	write(*_output, &record, sizeof(record));
+	_frameCount += element.frameCount;
+	++_elementCount;
+}
+
+// a string is its quint32 size followed by its bytes, its id is the offset of the size in the blob
+quint32 DefinitionCache::intern (const StringView& text)
+{
+	if (text.isEmpty() && _textSize > 0) {
+		return EMPTY_STRING;
+	}
+	QHash<QByteArray, quint32>::const_iterator found = _index.constFind(QByteArray::fromRawData(text.data(), text.size()));
+	if (found != _index.constEnd()) {
+		return found.value();
+	}
+	const quint32 id = _textSize;
+	const quint32 size = quint32(text.size());
+	write(*_textSpill, &size, sizeof(size));
+	write(*_textSpill, text.data(), size);
+	_textSize += quint32(sizeof(size)) + size;
+	_index.insert(QByteArray(text.data(), text.size()), id);
+	return id;
+}
+
+void DefinitionCache::write (QIODevice& device, const void* data, qint64 size)
+{
+	_failed = _failed || (size > 0 && device.write(static_cast<const char*>(data), size) != size);
+}
+
+// copies a spilled table to the end of the file
+void DefinitionCache::append (QIODevice& from)
+{
+	_failed = _failed || !from.seek(0);
+	QByteArray chunk;
+	while (!_failed && !from.atEnd()) {
+		chunk = from.read(COPY_SIZE);
+		_failed = chunk.isEmpty();
+		write(*_output, chunk.constData(), chunk.size());
+	}
+}
+
+bool DefinitionCache::commit ()
+{
+	if (!_output) {
+		return false;
+	}
+	append(*_frameSpill);
+	write(*_output, _settings.data(), qint64(_settings.size() * sizeof(quint32)));
+	append(*_textSpill);
+
+	FileHeader header = FileHeader();
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.settingCount = quint32(_settings.size() / 2);
+	header.elementCount = _elementCount;
+	header.frameCount = _frameCount;
+	header.textSize = _textSize;
+	memcpy(header.hash, _hash.constData(), HASH_SIZE);
+	_failed = _failed || !_output->seek(0);
+	write(*_output, &header, sizeof(header));
+
+	const bool written = !_failed;
+	_output->close();
+	const bool committed = written && _output->error() == QFile::NoError && System.replaceFile(_output->fileName(), _path);
+	// removed by discard() otherwise
+	_output->setAutoRemove(!committed);
+	discard();
+	return committed;
+}
+
+// removes the unfinished file, also releases the spilled tables and the interned strings after a commit
+void DefinitionCache::discard ()
+{
+	delete _output;
+	delete _frameSpill;
+	delete _textSpill;
+	_output = NULL;
+	_frameSpill = NULL;
+	_textSpill = NULL;
+	_index.clear();
+	_settings.clear();
+}
+
+bool DefinitionCache::open (const QString& path, const QByteArray& hash)
+{
+	close();
+	if (hash.size() != HASH_SIZE) {
+		return false;
+	}
+	_file.setFileName(path);
+	if (!_file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	const qint64 size = _file.size();
+	if (size < qint64(sizeof(FileHeader)) || !(_data = _file.map(0, size))) {
+		close();
+		return false;
+	}
+
+	_header = reinterpret_cast<const FileHeader*>(_data);
+	if (_header->magic != CACHE_MAGIC || _header->version != CACHE_VERSION
+			|| memcmp(_header->hash, hash.constData(), HASH_SIZE) != 0) {
+		debug("ignoring compiled definition " + path);
+		close();
+		return false;
+	}
+	if (!mapTables(size)) {
+		warning("corrupt compiled definition " + path + ", parsing the XML");
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool DefinitionCache::isOpen () const
+{
+	return _header != NULL;
+}
+
+void DefinitionCache::close ()
+{
+	if (_data) {
+		_file.unmap(_data);
+	}
+	if (_file.isOpen()) {
+		_file.close();
+	}
+	_data = NULL;
+	_header = NULL;
+	_settingTable = NULL;
+	_elementTable = NULL;
+	_frameTable = NULL;
+	_textTable = NULL;
+}
+
+int DefinitionCache::getSettingCount () const
+{
+	return _header ? int(_header->settingCount) : 0;
+}
+
+void DefinitionCache::getSetting (int index, QString& tag, QString& text) const
+{
+	const SettingRecord& record = _settingTable[index];
+	const StringView tagView = getString(record.tag);
+	const StringView textView = getString(record.text);
+	tag = QString::fromUtf8(tagView.data(), tagView.size());
+	text = QString::fromUtf8(textView.data(), textView.size());
+}
+
+int DefinitionCache::getElementCount () const
+{
+	return _header ? int(_header->elementCount) : 0;
+}
+
+void DefinitionCache::getElement (int index, Element& element) const
+{
+	const ElementRecord& record = _elementTable[index];
+	element.clazz = Content::Class(record.clazz);
+	element.tag = getString(record.tag);
+	for (int field = 0; field < FIELDS; ++field) {
+		element.fields[field] = getString(record.fields[field]);
+	}
+	element.firstFrame = record.firstFrame;
+	element.frameCount = record.frameCount;
+}
+
+void DefinitionCache::getFrame (quint32 index, Frame& frame) const
+{
+	const FrameRecord& record = _frameTable[index];
+	frame.tag = getString(record.tag);
+	for (int field = 0; field < FIELDS; ++field) {
+		frame.fields[field] = getString(record.fields[field]);
+	}
+}
+
+StringView DefinitionCache::getString (quint32 id) const
+{
+	quint32 size;
+	memcpy(&size, _textTable + id, sizeof(size));
+	return StringView(_textTable + id + sizeof(size), int(size));
+}
+
+bool DefinitionCache::isString (quint32 id) const
+{
+	quint32 size;
+	if (id > _header->textSize || _header->textSize - id < sizeof(size)) {
+		return false;
+	}
+	memcpy(&size, _textTable + id, sizeof(size));
+	return size <= _header->textSize - id - sizeof(size);
+}
+
+// locates the tables and checks every reference once, so the getters need no checks
+bool DefinitionCache::mapTables (qint64 size)
+{
+	const FileHeader& h = *_header;
+	const quint64 expected = sizeof(FileHeader) + quint64(h.elementCount) * sizeof(ElementRecord)
+			+ quint64(h.frameCount) * sizeof(FrameRecord) + quint64(h.settingCount) * sizeof(SettingRecord) + h.textSize;
+	if (expected != quint64(size)) {
+		return false;
+	}
+
+	const uchar* table = _data + sizeof(FileHeader);
+	_elementTable = reinterpret_cast<const ElementRecord*>(table);
+	table += quint64(h.elementCount) * sizeof(ElementRecord);
+	_frameTable = reinterpret_cast<const FrameRecord*>(table);
+	table += quint64(h.frameCount) * sizeof(FrameRecord);
+	_settingTable = reinterpret_cast<const SettingRecord*>(table);
+	table += quint64(h.settingCount) * sizeof(SettingRecord);
+	_textTable = reinterpret_cast<const char*>(table);
+
+	for (quint32 i = 0; i < h.settingCount; ++i) {
+		if (!isString(_settingTable[i].tag) || !isString(_settingTable[i].text)) {
+			return false;
+		}
+	}
+	for (quint32 i = 0; i < h.frameCount; ++i) {
+		const FrameRecord& frame = _frameTable[i];
+		bool valid = isString(frame.tag);
+		for (int field = 0; valid && field < FIELDS; ++field) {
+			valid = isString(frame.fields[field]);
+		}
+		if (!valid) {
+			return false;
+		}
+	}
+	for (quint32 i = 0; i < h.elementCount; ++i) {
+		const ElementRecord& element = _elementTable[i];
+		bool valid = element.clazz <= Content::HOLDER && isString(element.tag)
+				&& quint64(element.firstFrame) + element.frameCount <= h.frameCount;
+		for (int field = 0; valid && field < FIELDS; ++field) {
+			valid = isString(element.fields[field]);
+		}
+		if (!valid) {
+			return false;
+		}
+	}
+	return true;
+}
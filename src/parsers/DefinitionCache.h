@@ -0,0 +1,131 @@
+/*
+ * DefinitionCache.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include "common/StringView.h"
+#include "constants/Content.h"
+
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QTemporaryFile>
+
+/**
+ * Compiled form of definition.xml keyed by the hash of its content. The header settings and the
+ * accepted library elements are flat tables of fixed size records whose strings are offsets into
+ * one interned UTF-8 blob. Records are appended while the XML is parsed and commit() puts the
+ * tables together, a later run maps the file and views the fields in place without parsing any XML.
+ */
+class DefinitionCache {
+private:
+	DefinitionCache (const DefinitionCache&);
+	DefinitionCache& operator= (const DefinitionCache&);
+
+public:
+	// the attributes read from an element or a frame, any other attribute is not kept
+	enum Field {
+		CLASS, NAME, PATH, X, Y, ALPHA, VISIBLE, FIELDS
+	};
+
+	struct Frame {
+		StringView tag;
+		StringView fields[FIELDS];
+	};
+
+	// an asset element of the library, its frames are a range of the list they were read into
+	struct Element {
+		Content::Class clazz;
+		StringView tag;
+		StringView fields[FIELDS];
+		quint32 firstFrame;
+		quint32 frameCount;
+	};
+
+	DefinitionCache ();
+	~DefinitionCache ();
+
+	static QByteArray hashFile (const QString& path);
+	static QString getCachePath (const QByteArray& hash);
+
+	// recording while the XML is parsed, only the interned strings are kept in memory
+	bool create (const QString& path, const QByteArray& hash);
+	void addSetting (const QString& tag, const QString& text);
+	void addElement (const Element& element, const Frame* frames);
+	bool commit ();
+	void discard ();
+
+	// reading a compiled definition, the views point into the mapping and are valid until close()
+	bool open (const QString& path, const QByteArray& hash);
+	bool isOpen () const;
+	void close ();
+	int getSettingCount () const;
+	void getSetting (int index, QString& tag, QString& text) const;
+	int getElementCount () const;
+	void getElement (int index, Element& element) const;
+	void getFrame (quint32 index, Frame& frame) const;
+
+private:
+	struct FileHeader;
+	struct SettingRecord;
+	struct ElementRecord;
+	struct FrameRecord;
+
+	quint32 intern (const StringView& text);
+	void write (QIODevice& device, const void* data, qint64 size);
+	void append (QIODevice& from);
+	StringView getString (quint32 id) const;
+	bool isString (quint32 id) const;
+	bool mapTables (qint64 size);
+
+	// the file being recorded next to the cache path, frames and strings are spilled until commit() appends them
+	QTemporaryFile* _output;
+	QTemporaryFile* _frameSpill;
+	QTemporaryFile* _textSpill;
+	QString _path;
+	QByteArray _hash;
+	QHash<QByteArray, quint32> _index;
+	std::vector<quint32> _settings;
+	quint32 _elementCount;
+	quint32 _frameCount;
+	quint32 _textSize;
+	bool _failed;
+
+	// the mapped file
+	QFile _file;
+	uchar* _data;
+	const FileHeader* _header;
+	const SettingRecord* _settingTable;
+	const ElementRecord* _elementTable;
+	const FrameRecord* _frameTable;
+	const char* _textTable;
+};
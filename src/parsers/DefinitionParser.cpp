@@ -32,11 +32,14 @@
 #include "constants/CompileMode.h"
 #include "ports/System.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
 
-#include <QDomDocument>
+#include <QDir>
 #include <QFile>
+#include <QStringList>
 
 namespace {
 const QString NODE_SPRITES = "sprites";
@@ -60,10 +63,29 @@ const QString ATTR_X = "x";
 const QString ATTR_Y = "y";
 const QString ATTR_ALPHA = "alpha";
 const QString ATTR_VISIBLE = "visible";
+
+// attribute of each DefinitionCache::Field
+const QString* const FIELD_ATTRIBUTES[] = { &ATTR_CLASS, &ATTR_NAME, &ATTR_PATH, &ATTR_X, &ATTR_Y, &ATTR_ALPHA, &ATTR_VISIBLE };
+static_assert(sizeof(FIELD_ATTRIBUTES) / sizeof(FIELD_ATTRIBUTES[0]) == DefinitionCache::FIELDS, "every field needs its attribute");
+
+// asset elements whose paths are checked with one batched stat call
+const size_t BATCH_SIZE = 1024;
+// assets the reader may queue ahead of the generator threads
+const size_t QUEUE_SIZE = 256;
+
+QString toString (const StringView& text)
+{
+	return QString::fromUtf8(text.data(), text.size());
+}
+
+QByteArray toBytes (const StringView& text)
+{
+	return QByteArray(text.data(), text.size());
+}
 }
 
 DefinitionParser::DefinitionParser () :
-		_definition(DEFINITION_NAME), _attributesMap(), _assets()
+		_attributesMap(), _cache(), _hash(), _elements(), _frames(), _text(), _queue(NULL), _placements(NULL), _classes(), _redefined(), _pathExists(), _missing()
 {
 
 }
@@ -74,71 +96,89 @@ DefinitionParser::~DefinitionParser ()
 
 bool DefinitionParser::getCompileArguments (CompileArguments& definition)
 {
-	QFile file(_targetDir.filePath(DEFINITION_NAME));
+	const QString path = _targetDir.filePath(DEFINITION_NAME);
+	QFile file(path);
 	if (!file.open(QIODevice::ReadOnly)) {
 		return false;
 	}
-	QString error;
-	if (!_definition.setContent(&file, true, &error)) {
-		file.close();
-		System.exit(QString(DEFINITION_NAME) + " => " + error, EXIT_FAILURE);
-	}
-	file.close();
-
-	QDomElement doc = _definition.documentElement();
-	QDomNode node = doc.firstChild();
-	const QString root = doc.toElement().tagName();
-	float player = 11.1;
-	int quality = 100;
-	bool hasLib = false;
-	CompileMode::Mode mode = CompileMode::COMPILE_DEFINITION;
 
-	while (!node.isNull()) {
-		QDomElement e = node.toElement();
-		node = node.nextSibling();
-
-		if (e.isNull()) {
-			continue;
+	Settings settings;
+	settings.player = 11.1;
+	settings.quality = 100;
+	settings.mode = CompileMode::COMPILE_DEFINITION;
+	settings.hasLib = false;
+
+	_hash = DefinitionCache::hashFile(path);
+	if (_cache.open(DefinitionCache::getCachePath(_hash), _hash)) {
+		QString tag;
+		QString text;
+		for (int i = 0; i < _cache.getSettingCount(); ++i) {
+			_cache.getSetting(i, tag, text);
+			applySetting(tag, text, settings, definition);
 		}
-
-		const QString text = e.text();
-		const QString tag = e.tagName();
-		if (tag == DefinitionNode::LIBRARY) {
-			hasLib = true;
-		} else if (tag == DefinitionNode::MODE) {
-			mode = CompileMode::Mode(text.toInt());
-		} else if (tag == DefinitionNode::PLAYER) {
-			player = text.toFloat();
-		} else if (tag == DefinitionNode::QUALITY) {
-			quality = text.toInt();
-			if (quality < 0 || quality > 100)
-				quality = 100;
-		} else if (tag == DefinitionNode::NAME) {
-			if (definition.name.isEmpty()) {
-				definition.name = text;
-			}
-		} else if (tag == DefinitionNode::SWC) {
-			if(text.toInt() == 1) {
-				definition.swc = true;
+		file.close();
+	} else {
+		QXmlStreamReader xml(&file);
+		if (xml.readNextStartElement()) {
+			const QString root = xml.name().toString();
+			while (xml.readNextStartElement()) {
+				const QString tag = xml.name().toString();
+				// the library is only parsed by parse(), here it is skipped without being kept
+				if (tag == DefinitionNode::LIBRARY) {
+					settings.hasLib = true;
+					xml.skipCurrentElement();
+				} else if (!applySetting(tag, xml.readElementText(QXmlStreamReader::IncludeChildElements), settings, definition)) {
+					warnInvalidTag(tag, root);
+				}
 			}
-		} else {
-			warnInvalidTag(tag, root);
 		}
+		if (xml.hasError()) {
+			file.close();
+			System.exit(QString(DEFINITION_NAME) + " => " + xml.errorString(), EXIT_FAILURE);
+		}
+		file.close();
 	}
 
 	if (definition.mode == CompileMode::UNDEFINED) {
-		definition.mode = hasLib ? mode : CompileMode::COMPILE_ALL;
+		definition.mode = settings.hasLib ? settings.mode : CompileMode::COMPILE_ALL;
 	}
 	if (definition.player < 0) {
-		definition.player = player;
+		definition.player = settings.player;
 	}
 	if (definition.quality < 0) {
-		definition.quality = quality;
+		definition.quality = settings.quality;
 	}
 
 	return true;
 }
 
+bool DefinitionParser::applySetting (const QString& tag, const QString& text, Settings& settings,
+		CompileArguments& definition) const
+{
+	if (tag == DefinitionNode::LIBRARY) {
+		settings.hasLib = true;
+	} else if (tag == DefinitionNode::MODE) {
+		settings.mode = CompileMode::Mode(text.toInt());
+	} else if (tag == DefinitionNode::PLAYER) {
+		settings.player = text.toFloat();
+	} else if (tag == DefinitionNode::QUALITY) {
+		settings.quality = text.toInt();
+		if (settings.quality < 0 || settings.quality > 100)
+			settings.quality = 100;
+	} else if (tag == DefinitionNode::NAME) {
+		if (definition.name.isEmpty()) {
+			definition.name = text;
+		}
+	} else if (tag == DefinitionNode::SWC) {
+		if(text.toInt() == 1) {
+			definition.swc = true;
+		}
+	} else {
+		return false;
+	}
+	return true;
+}
+
 void DefinitionParser::parse ()
 {
 	info("parse definition.xml");
@@ -152,59 +192,181 @@ void DefinitionParser::parse ()
 	_attributesMap[ATTR_ALPHA] = 1;
 	_attributesMap[ATTR_VISIBLE] = 1;
 
-	QDomElement doc = _definition.documentElement();
-	QDomNode node = doc.firstChildElement(DefinitionNode::LIBRARY).firstChild();
+	QFile file(_targetDir.filePath(DEFINITION_NAME));
+	if (!_cache.isOpen() && !file.open(QIODevice::ReadOnly)) {
+		System.exit("cannot read " + QString(DEFINITION_NAME), EXIT_FAILURE);
+	}
 
-	while (!node.isNull()) {
-		QDomElement elem = node.toElement();
-		node = node.nextSibling();
+	const int writers = getWriterCount();
+	AssetQueue queue(QUEUE_SIZE);
+	std::vector<CompileList> created(writers);
+	std::vector<std::thread> workers;
+	_queue = &queue;
+	for (int i = 0; i < writers; ++i) {
+		workers.push_back(std::thread(&DefinitionParser::generate, this, &created[i]));
+	}
 
-		if (elem.isNull()) {
-			continue;
+	bool valid = true;
+	if (_cache.isOpen()) {
+		readCompiled();
+	} else {
+		valid = readXml(file);
+	}
+	flushElements();
+
+	queue.close();
+	for (std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i) {
+		i->join();
+	}
+	_queue = NULL;
+
+	// the last definition of a class wins like it did in the former map of assets, once the workers are done it overwrites the first
+	for (std::map<QByteArray, Asset*>::const_iterator i = _redefined.begin(); i != _redefined.end(); ++i) {
+		if (createAsset(i->second)) {
+			created.front().push_back(i->first);
+		}
+		delete i->second;
+	}
+	_redefined.clear();
+	_classes.clear();
+
+	reportMissingPaths();
+	if (!valid) {
+		return;
+	}
+
+	// classes are listed by name like the former map of assets, a redefined class only once
+	for (std::vector<CompileList>::const_iterator i = created.begin(); i != created.end(); ++i) {
+		_compileList.insert(_compileList.end(), i->begin(), i->end());
+	}
+	sortClasses(_compileList, false);
+	_compileList.erase(std::unique(_compileList.begin(), _compileList.end()), _compileList.end());
+	createMainClass();
+	removeStaleFiles();
+}
+
+// reads the library like parse() but only keeps the placements of its assets, keyed for a directory scan to join onto
+void DefinitionParser::indexPlacements (PlacementIndex& index)
+{
+	_placements = &index;
+	QFile file(_targetDir.filePath(DEFINITION_NAME));
+	if (_cache.isOpen()) {
+		readCompiled();
+	} else if (file.open(QIODevice::ReadOnly)) {
+		readXml(file);
+	}
+	flushElements();
+	_placements = NULL;
+	info("indexed " + QString::number(index.files.size()) + " placements from " + DEFINITION_NAME);
+}
+
+void DefinitionParser::readCompiled ()
+{
+	info("using compiled " + QString(DEFINITION_NAME));
+	const int count = _cache.getElementCount();
+	Element element;
+	Frame frame;
+	for (int i = 0; i < count; ++i) {
+		_cache.getElement(i, element);
+		const quint32 first = element.firstFrame;
+		element.firstFrame = quint32(_frames.size());
+		for (quint32 f = 0; f < element.frameCount; ++f) {
+			_cache.getFrame(first + f, frame);
+			_frames.push_back(frame);
+		}
+		_elements.push_back(element);
+		if (_elements.size() >= BATCH_SIZE) {
+			flushElements();
 		}
+	}
+	// the batch views the mapping
+	flushElements();
+	_cache.close();
+}
 
-		const QString text = elem.text();
-		const QString tag = elem.tagName();
+// streams the library into the pipeline and records it, the compiled form is committed once the whole file parsed
+bool DefinitionParser::readXml (QFile& file)
+{
+	if (!_cache.create(DefinitionCache::getCachePath(_hash), _hash)) {
+		debug("not caching " + QString(DEFINITION_NAME));
+	}
+	QXmlStreamReader xml(&file);
+	if (xml.readNextStartElement()) {
+		while (xml.readNextStartElement()) {
+			const QString tag = xml.name().toString();
+			Settings settings;
+			CompileArguments arguments = CompileArguments();
+			if (tag == DefinitionNode::LIBRARY) {
+				_cache.addSetting(tag, QString());
+				parseLibrary(xml);
+			} else {
+				const QString text = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+				if (applySetting(tag, text, settings, arguments)) {
+					_cache.addSetting(tag, text);
+				}
+			}
+		}
+	}
+	file.close();
+
+	if (xml.hasError()) {
+		_cache.discard();
+		flushElements();
+		System.exit(QString(DEFINITION_NAME) + " => " + xml.errorString(), EXIT_FAILURE);
+		return false;
+	}
+	_cache.commit();
+	return true;
+}
+
+void DefinitionParser::generate (CompileList* created)
+{
+	const Asset* asset;
+	while (_queue->pop(asset)) {
+		if (createAsset(asset)) {
+			created->push_back(asset->name);
+		}
+		delete asset;
+	}
+}
+
+bool DefinitionParser::createAsset (const Asset* asset)
+{
+	if (asset->clazz == Content::MOVIECLIP || asset->clazz == Content::SPRITE) {
+		return AbstractAssetsParser::createFileSprite(static_cast<const SpriteAsset*>(asset));
+	}
+	return AbstractAssetsParser::createFileCommon(asset->name, asset->path);
+}
 
-		QDomNode n(elem.firstChild());
+void DefinitionParser::parseLibrary (QXmlStreamReader& xml)
+{
+	while (xml.readNextStartElement()) {
+		const QString tag = xml.name().toString();
 		if (tag == ::NODE_SPRITES) {
-			parseAssetNodes(n, Content::SPRITE);
+			parseAssetNodes(xml, Content::SPRITE);
 		} else if (tag == ::NODE_MOVIECLIPS) {
-			parseAssetNodes(n, Content::MOVIECLIP);
+			parseAssetNodes(xml, Content::MOVIECLIP);
 		} else if (tag == ::NODE_BITMAPS) {
-			parseAssetNodes(n, Content::BITMAPDATA);
+			parseAssetNodes(xml, Content::BITMAPDATA);
 		} else if (tag == ::NODE_SOUNDS) {
-			parseAssetNodes(n, Content::SOUND);
+			parseAssetNodes(xml, Content::SOUND);
 		} else if (tag == ::NODE_BINARIES) {
-			parseAssetNodes(n, Content::BYTEARRAY);
-		} else {
-			warnInvalidTag(tag, node.parentNode().nodeName());
-		}
-	}
-
-	for (std::map<QString, Asset*>::const_iterator i = _assets.begin(); i != _assets.end(); ++i) {
-		const Asset* asset = i->second;
-		if (asset->clazz == Content::MOVIECLIP || asset->clazz == Content::SPRITE) {
-			AbstractAssetsParser::createFileSprite(static_cast<const SpriteAsset*>(asset));
+			parseAssetNodes(xml, Content::BYTEARRAY);
 		} else {
-			AbstractAssetsParser::createFileCommon(asset->name, asset->path);
+			warnInvalidTag(tag, DefinitionNode::LIBRARY);
+			xml.skipCurrentElement();
 		}
-		delete asset;
 	}
-	createMainClass();
 }
 
-void DefinitionParser::parseAssetNodes (QDomNode& node, const Content::Class clazz)
+void DefinitionParser::parseAssetNodes (QXmlStreamReader& xml, const Content::Class clazz)
 {
-	bool sprite = false;
 	QString nodeName;
 	switch (clazz) {
 	case Content::MOVIECLIP:
 		nodeName = NODE_MOVIECLIP;
-		sprite = true;
 		break;
 	case Content::SPRITE:
-		sprite = true;
 		nodeName = NODE_SPRITE;
 		break;
 	case Content::BITMAPDATA:
@@ -218,107 +380,187 @@ void DefinitionParser::parseAssetNodes (QDomNode& node, const Content::Class cla
 		break;
 	default:
 		error("invalid class type " + QString::number(clazz));
+		xml.skipCurrentElement();
 		return;
 	}
-	while (!node.isNull()) {
-		QDomElement elem = node.toElement();
-		QDomNode parseNode = node;
-		QDomNamedNodeMap attributes = node.attributes();
-		QDomNode frame = node.firstChild();
-		checkAttributes(node);
-		node = node.nextSibling();
 
-		if (elem.isNull()) {
+	const QString parent = xml.name().toString();
+	while (xml.readNextStartElement()) {
+		const QString tag = xml.name().toString();
+		const QXmlStreamAttributes attributes = xml.attributes();
+		checkAttributes(tag, attributes);
+		if (nodeName != tag) {
+			warnInvalidTag(tag, parent);
+			xml.skipCurrentElement();
 			continue;
 		}
-
-		const QString tag = elem.tagName();
-		if (nodeName != tag) {
-			warnInvalidTag(tag, parseNode.parentNode().nodeName());
+		if (attributes.value(ATTR_CLASS).isEmpty()) {
+			warnMissingAttr(ATTR_CLASS, tag);
+			xml.skipCurrentElement();
 			continue;
 		}
 
-		if (attributes.isEmpty() || attributes.namedItem(ATTR_CLASS).nodeValue().isEmpty()) {
-			warnMissingAttr(ATTR_CLASS, tag);
+		_elements.push_back(Element());
+		readElement(xml, clazz, _elements.back());
+		_cache.addElement(_elements.back(), _frames.data() + _elements.back().firstFrame);
+		if (_elements.size() >= BATCH_SIZE) {
+			flushElements();
+		}
+	}
+}
+
+// the frames of the element are appended to the batch
+void DefinitionParser::readElement (QXmlStreamReader& xml, const Content::Class clazz, Element& element)
+{
+	element.clazz = clazz;
+	element.tag = keepText(xml.name());
+	readFields(xml.attributes(), element.fields);
+	element.firstFrame = quint32(_frames.size());
+	element.frameCount = 0;
+
+	const bool sprite = clazz == Content::SPRITE || clazz == Content::MOVIECLIP;
+	while (xml.readNextStartElement()) {
+		if (sprite) {
+			const QXmlStreamAttributes attributes = xml.attributes();
+			checkAttributes(xml.name().toString(), attributes);
+			_frames.push_back(Frame());
+			_frames.back().tag = keepText(xml.name());
+			readFields(attributes, _frames.back().fields);
+			++element.frameCount;
+		}
+		xml.skipCurrentElement();
+	}
+}
+
+void DefinitionParser::readFields (const QXmlStreamAttributes& attributes, StringView* fields)
+{
+	for (int i = 0; i < DefinitionCache::FIELDS; ++i) {
+		fields[i] = keepText(attributes.value(*::FIELD_ATTRIBUTES[i]));
+	}
+}
+
+// the text lives until the batch is flushed, absent attributes stay null views
+StringView DefinitionParser::keepText (const QStringRef& text)
+{
+	if (text.isEmpty()) {
+		return StringView();
+	}
+	_text.push_back(text.toUtf8());
+	return StringView(_text.back());
+}
+
+void DefinitionParser::flushElements ()
+{
+	if (_placements) {
+		indexElements();
+	} else {
+		prefetchPaths();
+		for (ElementList::const_iterator i = _elements.begin(); i != _elements.end(); ++i) {
+			Asset* asset = i->frameCount == 0 ? createSingleFrameAsset(*i) : createMultiFrameSprite(*i);
+			if (asset && claimClass(asset)) {
+				_queue->push(asset);
+			}
+		}
+		_pathExists.clear();
+	}
+	_elements.clear();
+	_frames.clear();
+	_text.clear();
+}
+
+// the last definition of a path or class wins, as it does for the generated classes
+void DefinitionParser::indexElements ()
+{
+	for (ElementList::const_iterator i = _elements.begin(); i != _elements.end(); ++i) {
+		const QString path = toString(i->fields[DefinitionCache::PATH]);
+		if (path.isEmpty()) {
+			continue;
+		}
+		if (i->frameCount == 0) {
+			_placements->files.insert(QDir::cleanPath(_targetDir.absoluteFilePath(path)), makePlacement(i->fields));
 			continue;
 		}
 
-		if (frame.isNull() || !sprite) {
-			createSingleFrameAsset(parseNode, clazz, nodeName);
-		} else {
-			createMultiFrameSprite(frame, clazz);
+		_placements->classes.insert(toBytes(i->fields[DefinitionCache::CLASS]), makePlacement(i->fields));
+		const Frame* frames = _frames.data() + i->firstFrame;
+		for (quint32 f = 0; f < i->frameCount; ++f) {
+			const QString file = QDir::cleanPath(_targetDir.absoluteFilePath(path + toString(frames[f].fields[DefinitionCache::PATH])));
+			_placements->files.insert(file, makePlacement(frames[f].fields));
 		}
 	}
 }
 
-bool DefinitionParser::createSingleFrameAsset (QDomNode& node, const Content::Class clazz, const QString& tag)
+Placement DefinitionParser::makePlacement (const StringView* fields) const
+{
+	Placement placement;
+	placement.x = toBytes(fields[DefinitionCache::X]);
+	placement.y = toBytes(fields[DefinitionCache::Y]);
+	placement.alpha = toBytes(fields[DefinitionCache::ALPHA]);
+	placement.visible = toBytes(fields[DefinitionCache::VISIBLE]);
+	return placement;
+}
+
+DefinitionParser::Asset* DefinitionParser::createSingleFrameAsset (const Element& element)
 {
-	QDomNamedNodeMap attr = node.attributes();
-	const QString name = attr.namedItem(ATTR_CLASS).nodeValue();
-	const QString pathattr = attr.namedItem(ATTR_PATH).nodeValue();
+	const StringView* attr = element.fields;
+	const QString tag = toString(element.tag);
+	const Content::Class clazz = element.clazz;
+	const QString name = toString(attr[DefinitionCache::CLASS]);
+	const QString pathattr = toString(attr[DefinitionCache::PATH]);
 	if (pathattr.isEmpty()) {
 		warnMissingAttr(ATTR_PATH, tag);
-		return false;
+		return NULL;
 	}
 	const QString path = _targetDir.absoluteFilePath(pathattr);
 	if (!checkPathExists(path)) {
-		return false;
+		return NULL;
 	}
 	if (name.isEmpty()) {
 		warnMissingAttr(ATTR_CLASS, tag);
-		return false;
+		return NULL;
 	}
 	if (clazz == Content::SPRITE || clazz == Content::MOVIECLIP) {
 		struct AssetBit asset;
-		asset.path = _tempDir.relativeFilePath(path);
+		asset.path = _tempDir.relativeFilePath(path).toUtf8();
 		copyAttributes(&asset, attr);
 		struct SpriteAsset* sprite = new SpriteAsset();
-		sprite->assets.push_back(asset);
+		sprite->assets.push_back(std::move(asset));
 		sprite->clazz = clazz;
-		sprite->name = name;
-		_assets[name] = sprite;
-	} else {
-		struct Asset* common = new Asset();
-		common->path = path;
-		common->name = name;
-		_assets[name] = common;
+		sprite->name = name.toUtf8();
+		return sprite;
 	}
-	return true;
+	struct Asset* common = new Asset();
+	common->clazz = clazz;
+	common->path = path.toUtf8();
+	common->name = name.toUtf8();
+	return common;
 }
 
-bool DefinitionParser::createMultiFrameSprite (QDomNode& frame, const Content::Class clazz)
+DefinitionParser::Asset* DefinitionParser::createMultiFrameSprite (const Element& element)
 {
-	QDomNode parent = frame.parentNode();
-	QDomNamedNodeMap attributes = parent.attributes();
+	const StringView* attributes = element.fields;
+	const Content::Class clazz = element.clazz;
 	const QString childName = clazz == Content::MOVIECLIP ? ::NODE_FRAME : ::NODE_OBJECT;
-	const QString className = attributes.namedItem(ATTR_CLASS).nodeValue();
-	const QString basePath = attributes.namedItem(ATTR_PATH).nodeValue();
+	const QString className = toString(attributes[DefinitionCache::CLASS]);
+	const QString basePath = toString(attributes[DefinitionCache::PATH]);
 	const QString absBasePath = _targetDir.absoluteFilePath(basePath);
 	struct SpriteAsset* sprite = NULL;
 
-	if (!QFile::exists(absBasePath)) {
-		info("base path \'" + absBasePath + "\' does not exist");
-		return false;
+	if (!checkPathExists(absBasePath)) {
+		return NULL;
 	}
 
-	while (!frame.isNull()) {
-		QDomElement e = frame.toElement();
-		QDomNamedNodeMap attr = frame.attributes();
-		checkAttributes(frame);
-		frame = frame.nextSibling();
-
-		if (e.isNull()) {
-			continue;
-		}
-
-		const QString tn = e.tagName();
+	const Frame* frames = _frames.data() + element.firstFrame;
+	for (quint32 f = 0; f < element.frameCount; ++f) {
+		const QString tn = toString(frames[f].tag);
+		const StringView* attr = frames[f].fields;
 		if (tn != childName) {
-			warnInvalidTag(tn, frame.parentNode().nodeName());
+			warnInvalidTag(tn, toString(element.tag));
 			continue;
 		}
 
-		const QString relpath = attr.namedItem(ATTR_PATH).nodeValue();
-		if (attr.isEmpty() || relpath.isEmpty()) {
+		const QString relpath = toString(attr[DefinitionCache::PATH]);
+		if (relpath.isEmpty()) {
 			warnMissingAttr(ATTR_PATH, tn);
 			continue;
 		}
@@ -328,52 +570,109 @@ bool DefinitionParser::createMultiFrameSprite (QDomNode& frame, const Content::C
 			continue;
 		}
 		struct AssetBit asset;
-		asset.name = attr.namedItem(ATTR_NAME).nodeValue();
-		asset.path = _tempDir.relativeFilePath(path);
+		asset.name = toBytes(attr[DefinitionCache::NAME]);
+		asset.path = _tempDir.relativeFilePath(path).toUtf8();
 		copyAttributes(&asset, attr);
 		if (!sprite) {
 			sprite = new SpriteAsset();
 		}
-		sprite->assets.push_back(asset);
+		sprite->assets.push_back(std::move(asset));
 	}
 	if (sprite) {
 		sprite->clazz = clazz;
-		sprite->name = className;
+		sprite->name = className.toUtf8();
 		copyAttributes(sprite, attributes);
-		_assets[className] = sprite;
 	}
-	return true;
+	return sprite;
 }
 
-void DefinitionParser::copyAttributes (AssetBit* asset, const QDomNamedNodeMap& attributes) const
+// false when the class was defined before, its last definition is then kept for parse() to generate
+bool DefinitionParser::claimClass (Asset* asset)
 {
-	asset->x = attributes.namedItem(ATTR_X).nodeValue();
-	asset->y = attributes.namedItem(ATTR_Y).nodeValue();
-	asset->alpha = attributes.namedItem(ATTR_ALPHA).nodeValue();
-	asset->visible = attributes.namedItem(ATTR_VISIBLE).nodeValue();
+	if (!_classes.contains(asset->name)) {
+		_classes.insert(asset->name);
+		return true;
+	}
+	debug("class \'" + QString::fromUtf8(asset->name) + "\' defined again in " + DEFINITION_NAME);
+	Asset*& last = _redefined[asset->name];
+	delete last;
+	last = asset;
+	return false;
 }
 
-inline void DefinitionParser::checkAttributes (QDomNode& node) const
+void DefinitionParser::copyAttributes (AssetBit* asset, const StringView* fields) const
 {
-	const QString tag = node.toElement().tagName();
-	QDomNamedNodeMap attr = node.attributes();
-	for (int i = 0; i < attr.size(); ++i) {
-		QDomNode a = attr.item(i);
-		if (!_attributesMap[a.nodeName()]) {
-			warning("invalid attribute \'" + a.nodeName() + "\' in \'" + tag + "\'");
+	asset->x = toBytes(fields[DefinitionCache::X]);
+	asset->y = toBytes(fields[DefinitionCache::Y]);
+	asset->alpha = toBytes(fields[DefinitionCache::ALPHA]);
+	asset->visible = toBytes(fields[DefinitionCache::VISIBLE]);
+}
+
+inline void DefinitionParser::checkAttributes (const QString& tag, const QXmlStreamAttributes& attributes) const
+{
+	for (int i = 0; i < attributes.size(); ++i) {
+		const QString name = attributes.at(i).name().toString();
+		if (!_attributesMap[name]) {
+			warning("invalid attribute \'" + name + "\' in \'" + tag + "\'");
+		}
+	}
+}
+
+// every path of a batch is collected first and checked in one call, which the ports spread over threads
+void DefinitionParser::prefetchPaths ()
+{
+	QStringList paths;
+	for (ElementList::const_iterator asset = _elements.begin(); asset != _elements.end(); ++asset) {
+		const QString path = toString(asset->fields[DefinitionCache::PATH]);
+		collectPath(_targetDir.absoluteFilePath(path), paths);
+		const Frame* frames = _frames.data() + asset->firstFrame;
+		for (quint32 f = 0; f < asset->frameCount; ++f) {
+			collectPath(_targetDir.absoluteFilePath(path + toString(frames[f].fields[DefinitionCache::PATH])), paths);
 		}
 	}
+
+	FileStatList stats;
+	System.getFileStats(paths, stats);
+	for (int i = 0; i < paths.size(); ++i) {
+		_pathExists.insert(paths.at(i), stats[i].exists);
+	}
+}
+bool DefinitionParser::pathExists (const QString& path) const
+{
+	QHash<QString, bool>::const_iterator found = _pathExists.constFind(path);
+	return found != _pathExists.constEnd() ? found.value() : QFile::exists(path);
 }
 
-bool DefinitionParser::checkPathExists (const QString& path) const
+// paths shared by several assets are only checked once per batch
+void DefinitionParser::collectPath (const QString& path, QStringList& paths)
 {
-	const bool exists = QFile::exists(path);
+	if (!_pathExists.contains(path)) {
+		_pathExists.insert(path, false);
+		paths.append(path);
+	}
+}
+
+bool DefinitionParser::checkPathExists (const QString& path)
+{
+	const bool exists = pathExists(path);
 	if (!exists) {
-		warning("path \'" + path + "\' does not exist");
+		_missing.append(path);
 	}
 	return exists;
 }
 
+// missing paths are reported once for the whole definition instead of one warning each
+void DefinitionParser::reportMissingPaths ()
+{
+	if (_missing.isEmpty()) {
+		return;
+	}
+	_missing.sort();
+	_missing.removeDuplicates();
+	warning(QString::number(_missing.size()) + " paths in " + DEFINITION_NAME + " do not exist:\n\t" + _missing.join("\n\t"));
+	_missing.clear();
+}
+
 void DefinitionParser::warnInvalidTag (const QString& tag, const QString& parent) const
 {
 	warning("invalid node \'" + tag + "\' in parent \'" + parent + "\' within " + DEFINITION_NAME);
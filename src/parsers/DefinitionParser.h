@@ -29,20 +29,33 @@
 #pragma once
 
 #include "AbstractAssetsParser.h"
+#include "DefinitionCache.h"
+#include "Placement.h"
+#include "common/BoundedQueue.h"
 #include "constants/CompileMode.h"
 #include "constants/Content.h"
 
 #include <map>
+#include <utility>
 #include <vector>
 
-#include <QDomDocument>
-#include <QDomNamedNodeMap>
-#include <QDomNode>
-#include <QFileInfo>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QXmlStreamAttributes>
+#include <QXmlStreamReader>
 
 #define DEFINITION_NAME "definition.xml"
 
+/**
+ * Generates the asset classes listed in definition.xml. The file is read with a pull parser, the
+ * library is turned into assets in batches while generator threads write the classes, so memory
+ * stays bounded by the batch and queue sizes rather than the size of the definition. A definition
+ * parsed once is read back from its compiled form in the DefinitionCache on later runs.
+ */
 class DefinitionParser: public AbstractAssetsParser {
 public:
 	DefinitionParser ();
@@ -59,19 +72,62 @@ public:
 	};
 
 	bool getCompileArguments (CompileArguments& definition);
+	void indexPlacements (PlacementIndex& index);
 
 private:
-	void parseAssetNodes (QDomNode& node, const Content::Class clazz);
-	bool createSingleFrameAsset (QDomNode& node, const Content::Class clazz, const QString& tag);
-	bool createMultiFrameSprite (QDomNode& frame, const Content::Class clazz);
-	void copyAttributes (AssetBit* asset, const QDomNamedNodeMap& attributes) const;
+	typedef BoundedQueue<const Asset*> AssetQueue;
+	// an asset element as read, resolved into an Asset once its batch of paths is checked
+	typedef DefinitionCache::Element Element;
+	typedef DefinitionCache::Frame Frame;
+	typedef std::vector<Element> ElementList;
+	typedef std::vector<Frame> FrameList;
+
+	struct Settings {
+		float player;
+		int quality;
+		CompileMode::Mode mode;
+		bool hasLib;
+	};
+
+	bool applySetting (const QString& tag, const QString& text, Settings& settings, CompileArguments& definition) const;
+	void generate (CompileList* created);
+	bool createAsset (const Asset* asset);
+	void readCompiled ();
+	bool readXml (QFile& file);
+	void parseLibrary (QXmlStreamReader& xml);
+	void parseAssetNodes (QXmlStreamReader& xml, const Content::Class clazz);
+	void readElement (QXmlStreamReader& xml, const Content::Class clazz, Element& element);
+	void readFields (const QXmlStreamAttributes& attributes, StringView* fields);
+	StringView keepText (const QStringRef& text);
+	void flushElements ();
+	void indexElements ();
+	Placement makePlacement (const StringView* fields) const;
+	Asset* createSingleFrameAsset (const Element& element);
+	Asset* createMultiFrameSprite (const Element& element);
+	void copyAttributes (AssetBit* asset, const StringView* fields) const;
+	void prefetchPaths ();
+	void collectPath (const QString& path, QStringList& paths);
+	bool pathExists (const QString& path) const;
+	bool claimClass (Asset* asset);
 
-	inline void checkAttributes (QDomNode& node) const;
-	inline bool checkPathExists (const QString& path) const;
+	inline void checkAttributes (const QString& tag, const QXmlStreamAttributes& attributes) const;
+	inline bool checkPathExists (const QString& path);
+	void reportMissingPaths ();
 	inline void warnInvalidTag (const QString& tag, const QString& parent) const;
 	inline void warnMissingAttr (const QString& attr, const QString& tag) const;
 
-	QDomDocument _definition;
 	mutable std::map<QString, int> _attributesMap;
-	std::map<QString, Asset*> _assets;
+	DefinitionCache _cache;
+	QByteArray _hash;
+	// the batch being read, its views point into _text or into the mapped compiled definition
+	ElementList _elements;
+	FrameList _frames;
+	std::vector<QByteArray> _text;
+	AssetQueue* _queue;
+	PlacementIndex* _placements;
+	QSet<QByteArray> _classes;
+	// the last definition of each class defined more than once
+	std::map<QByteArray, Asset*> _redefined;
+	QHash<QString, bool> _pathExists;
+	QStringList _missing;
 };
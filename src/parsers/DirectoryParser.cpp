@@ -31,56 +31,72 @@
 #include "constants/FileType.h"
 #include "constants/Content.h"
 
-#include <dirent.h>
-#include <fstream>
-#include <iostream>
-#include <map>
+#include <algorithm>
 #include <stdlib.h>
+#include <thread>
+#include <utility>
 
 #include <QByteArray>
+#include <QDateTime>
 #include <QElapsedTimer>
 #include <QFile>
-#include <QFileInfo>
-#include <QFileInfoList>
 
 namespace {
-const QString PATTERN_DIGITS = "\\d+";
-const QRegExp REGEXP_DIGITS(PATTERN_DIGITS);
+const int ENTRY_DIR = -3;
+const int ENTRY_FRAME = -2;
+const int ENTRY_COMMON = -1;
+// asset jobs the walker may queue ahead of the generator threads
+const size_t QUEUE_SIZE = 256;
 }
 
 DirectoryParser::DirectoryParser () :
 		AbstractAssetsParser(),
-		_regExpMc(),
-		_regExpSp(),
-		_regExpMc0(),
-		_regExpSp0(),
-		_suffixIgnorePattern(),
-		_currDirList(),
+		_matcher(),
+		_ignore(),
+		_queue(NULL),
+		_tree(NULL),
+		_nodes(),
+		_placements(NULL),
+		_incremental(false),
+		_rescan(false),
 		_ignoreHidden(true)
 {
 }
 
 DirectoryParser::~DirectoryParser ()
 {
+	delete _tree;
 }
 
-void DirectoryParser::setMovieclipPattern (const QString& pattern)
+bool DirectoryParser::setMovieclipPattern (const QString& pattern)
 {
-	const int index = pattern.indexOf(PATTERN_DIGITS);
-	_regExpMc.setPattern(pattern);
-	_regExpMc0.setPattern(QString(pattern).replace(index, PATTERN_DIGITS.length(), QString::number(0)));
+	return _matcher.setMovieclipPattern(pattern);
 }
 
-void DirectoryParser::setSpritePattern (const QString& pattern)
+bool DirectoryParser::setSpritePattern (const QString& pattern)
 {
-	const int index = pattern.indexOf(PATTERN_DIGITS);
-	_regExpSp.setPattern(pattern);
-	_regExpSp0.setPattern(QString(pattern).replace(index, PATTERN_DIGITS.length(), QString::number(0)));
+	return _matcher.setSpritePattern(pattern);
 }
 
 void DirectoryParser::setSuffixIgnorePattern (const QString& pattern)
 {
-	_suffixIgnorePattern = pattern;
+	_matcher.setSuffixIgnorePattern(pattern);
+}
+
+void DirectoryParser::setIncremental (bool incremental)
+{
+	_incremental = incremental;
+}
+
+void DirectoryParser::setRescan (bool rescan)
+{
+	_rescan = rescan;
+}
+
+// definition.xml entries joined onto the scanned files by path, each file costs one lookup
+void DirectoryParser::setPlacements (const PlacementIndex* placements)
+{
+	_placements = placements;
 }
 
 void DirectoryParser::parse ()
@@ -88,101 +104,506 @@ void DirectoryParser::parse ()
 	init();
 	QElapsedTimer etime;
 	etime.start();
-	parse(_targetDir);
+
+	const QString manifestPath = ScanManifest::getManifestPath(_targetDir);
+	const qint64 timestamp = QDateTime::currentMSecsSinceEpoch() * 1000000;
+	_ignore.load(_targetDir);
+	ScanManifest previous;
+	// cached listings are already filtered and classified, so they are only valid for the same rules and patterns
+	const QByteArray fingerprint = _ignore.getFingerprint() + _matcher.getFingerprint();
+	if (!_rescan && previous.load(manifestPath) && previous.getFingerprint() != fingerprint) {
+		previous.clear();
+	}
+	ScanManifest manifest;
+	manifest.setTimestamp(timestamp);
+	manifest.setFingerprint(fingerprint);
+	const bool record = manifest.create(manifestPath);
+
+	const int writers = getWriterCount();
+	AssetQueue queue(QUEUE_SIZE);
+	std::vector<GeneratedList> generated(writers);
+	std::vector<std::thread> workers;
+	_queue = &queue;
+	for (int i = 0; i < writers; ++i) {
+		workers.push_back(std::thread(&DirectoryParser::generate, this, &generated[i]));
+	}
+
+	DirectoryWalker walker;
+	walker.setJobs(_jobs);
+	walker.setManifest(&previous);
+	walker.setManifestWriter(record ? &manifest : NULL);
+	walker.setKeepFiles(_incremental);
+	walker.setIgnoreMatcher(&_ignore);
+	walker.setNameMatcher(&_matcher);
+	walker.setVisitor(this);
+	DirectoryWalker::Node* tree = walker.walk(_targetDir);
+	DirectoryWalker::logListed(tree);
+
+	queue.close();
+	for (std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i) {
+		i->join();
+	}
+	_queue = NULL;
+
+	GeneratedList classes;
+	for (std::vector<GeneratedList>::const_iterator i = generated.begin(); i != generated.end(); ++i) {
+		classes.insert(classes.end(), i->begin(), i->end());
+	}
+	std::sort(classes.begin(), classes.end());
+	for (GeneratedList::const_iterator i = classes.begin(); i != classes.end(); ++i) {
+		_compileList.push_back(i->name);
+	}
+
+	previous.clear();
+	if (record) {
+		manifest.commit();
+	}
+
+	if (_incremental) {
+		_tree = tree;
+		indexNodes(_tree);
+	} else {
+		delete tree;
+	}
 	createMainClass();
+	removeStaleFiles();
 	info("parsing took " + QString::number(etime.elapsed() / (float) 1000) + " seconds");
 }
 
-void DirectoryParser::parse (QDir& dir)
+void DirectoryParser::parse (const DirectoryWalker::Node* node)
+{
+	EntryList entries;
+	FrameGroupList groups;
+	groupFrames(node, entries, groups);
+	warnUnanchored(groups);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		createEntryFile(node, entries, groups, i);
+	}
+	for (std::vector<DirectoryWalker::Node*>::const_iterator i = node->children.begin(); i != node->children.end(); ++i) {
+		parse(*i);
+	}
+}
+
+// single files are queued batch by batch, sprites once the listing has all of their frames
+void DirectoryParser::visit (const DirectoryWalker::Node* node, DirectoryWalker::Listing& listing)
 {
-	info("parsing: " + dir.path());
-	dir.setFilter(QDir::Dirs | QDir::Files | QDir::NoSymLinks | QDir::NoDotAndDotDot);
-	dir.setSorting(QDir::Name);
-	QFileInfoList list = dir.entryInfoList();
-	for (int i = 0; i < list.size(); ++i) {
-		const QFileInfo& fileInfo = list.at(i);
-		if (fileInfo.isDir()) {
-			QDir sdir(fileInfo.filePath());
-			parse(sdir);
-		} else {
-			_currDirList = list;
-			createAssetFile(fileInfo);
+	DirectoryWalker::FileList files;
+	Grouping grouping;
+	size_t index = 0;
+	QString name;
+	while (listing.next(files)) {
+		for (DirectoryWalker::FileList::const_iterator i = files.begin(); i != files.end(); ++i, ++index) {
+			if (groupEntry(node, *i, index, grouping, name) == ENTRY_COMMON) {
+				AssetJob job;
+				makeCommonJob(node, *i, index, name, &job);
+				_queue->push(std::move(job));
+			}
 		}
 	}
 
+	sortFrames(grouping.groups);
+	warnUnanchored(grouping.groups);
+	for (FrameGroupList::const_iterator i = grouping.groups.begin(); i != grouping.groups.end(); ++i) {
+		if (i->anchored) {
+			AssetJob job;
+			makeSpriteJob(node, *i, &job);
+			_queue->push(std::move(job));
+		}
+	}
+}
+
+void DirectoryParser::generate (GeneratedList* generated)
+{
+	AssetJob job;
+	while (_queue->pop(job)) {
+		if (createAssetFile(job)) {
+			Generated created;
+			created.order = job.order;
+			created.name = job.name;
+			generated->push_back(created);
+		}
+	}
 }
 
-void DirectoryParser::createAssetFile (const QFileInfo& fileInfo)
+void DirectoryParser::makeCommonJob (const DirectoryWalker::Node* node, const DirectoryWalker::File& file, size_t index,
+		const QString& name, AssetJob* job) const
 {
-	QString name = fileInfo.completeBaseName();
-	removeIgnoredSuffix(name);
+	job->order = node->order;
+	job->order.push_back(quint32(index));
+	job->name = name.toUtf8();
+	job->sprite = false;
+	job->path = _tempDir.relativeFilePath(node->filePath(file)).toUtf8();
+	job->group.frames.clear();
+}
+
+void DirectoryParser::makeSpriteJob (const DirectoryWalker::Node* node, const FrameGroup& group, AssetJob* job) const
+{
+	job->order = node->order;
+	job->order.push_back(group.anchor);
+	job->name = group.name;
+	job->sprite = true;
+	job->path.clear();
+	job->group = group;
+}
+
+bool DirectoryParser::makeJob (const DirectoryWalker::Node* node, const EntryList& entries, const FrameGroupList& groups,
+		size_t index, AssetJob* job) const
+{
+	const Entry& entry = entries[index];
+	if (entry.group >= 0) {
+		makeSpriteJob(node, groups[entry.group], job);
+		return true;
+	}
+	if (entry.group == ENTRY_COMMON) {
+		makeCommonJob(node, node->files[index], index, entry.name, job);
+		return true;
+	}
+	return false;
+}
+
+bool DirectoryParser::createEntryFile (const DirectoryWalker::Node* node, const EntryList& entries,
+		const FrameGroupList& groups, size_t index)
+{
+	AssetJob job;
+	if (!makeJob(node, entries, groups, index, &job)) {
+		return false;
+	}
+	// only runs on the parser thread, a single asset that turned into a sprite is no longer embedded
+	forgetEmbed(job.name);
+	return createAssetFile(job);
+}
+
+bool DirectoryParser::createAssetFile (const AssetJob& job)
+{
+	return job.sprite ? createSpriteFile(job.group) : createFileCommon(job.name, job.path);
+}
+
+void DirectoryParser::groupFrames (const DirectoryWalker::Node* node, EntryList& entries, FrameGroupList& groups) const
+{
+	const DirectoryWalker::FileList& list = node->files;
+	Grouping grouping;
+	entries.resize(list.size());
+	for (size_t i = 0; i < list.size(); ++i) {
+		entries[i].group = groupEntry(node, list[i], i, grouping, entries[i].name);
+	}
+	sortFrames(grouping.groups);
+	groups.swap(grouping.groups);
+}
+
+/**
+ * Classifies one entry of a directory and adds a frame to its group. Returns the group when the
+ * entry is the frame 0 the sprite class is generated for, otherwise what kind of entry it is.
+ */
+int DirectoryParser::groupEntry (const DirectoryWalker::Node* node, const DirectoryWalker::File& fileInfo, size_t index,
+		Grouping& grouping, QString& name) const
+{
+	if (fileInfo.dir) {
+		return ENTRY_DIR;
+	}
+
+	// classified by the walker, or taken from the manifest for an unchanged directory
+	const NameMatcher::Match& match = fileInfo.match;
+	name = fileInfo.name.mid(match.begin, match.end - match.begin);
+	const Content::Class clazz = match.clazz;
+	const unsigned int frame = match.frame;
+	if (clazz == Content::UNDEFINED) {
+		return ENTRY_COMMON;
+	}
+
+	FrameGroupIndex& groupIndex = clazz == Content::MOVIECLIP ? grouping.movieclips : grouping.sprites;
+	FrameGroupList& groups = grouping.groups;
+	FrameGroupIndex::const_iterator found = groupIndex.constFind(name);
+	int group;
+	if (found == groupIndex.constEnd()) {
+		group = int(groups.size());
+		groupIndex.insert(name, group);
+		groups.push_back(FrameGroup());
+		groups.back().clazz = clazz;
+		groups.back().name = name.toUtf8();
+		groups.back().placement = findPlacement(groups.back().name);
+		groups.back().anchor = 0;
+		groups.back().anchored = false;
+	} else {
+		group = found.value();
+	}
+
+	FrameFile file;
+	const QString filePath = node->filePath(fileInfo);
+	file.index = frame;
+	file.path = _tempDir.relativeFilePath(filePath).toUtf8();
+	file.placement = findPlacement(filePath);
+	FrameGroup& frames = groups[group];
+	frames.frames.push_back(file);
+	if (frame == 0 && !frames.anchored) {
+		frames.anchored = true;
+		frames.anchor = quint32(index);
+		return group;
+	}
+	return ENTRY_FRAME;
+}
+
+void DirectoryParser::sortFrames (FrameGroupList& groups)
+{
+	for (FrameGroupList::iterator i = groups.begin(); i != groups.end(); ++i) {
+		std::stable_sort(i->frames.begin(), i->frames.end());
+	}
+}
 
-	if (!_regExpMc.isEmpty() && _regExpMc.indexIn(name) > -1) {
-		if (_regExpMc0.indexIn(name) > -1) {
-			parseSpriteImageList(QString(name).remove(_regExpMc), Content::MOVIECLIP);
+void DirectoryParser::warnUnanchored (const FrameGroupList& groups)
+{
+	for (FrameGroupList::const_iterator i = groups.begin(); i != groups.end(); ++i) {
+		if (!i->anchored) {
+			warning("no frame 0 found for \'" + QString::fromUtf8(i->name) + "\', skipping");
 		}
-	} else if (!_regExpSp.isEmpty() && _regExpSp.indexIn(name) > -1) {
-		if (_regExpSp0.indexIn(name) > -1) {
-			parseSpriteImageList(QString(name).remove(_regExpSp), Content::SPRITE);
+	}
+}
+
+bool DirectoryParser::createSpriteFile (const FrameGroup& group)
+{
+	// reused per thread, frames only allocate when a sprite has more than any before
+	static thread_local SpriteAsset sprite;
+	sprite.name = group.name;
+	sprite.clazz = group.clazz;
+	sprite.assets.resize(0);
+	applyPlacement(group.placement, sprite);
+
+	const FrameList& frames = group.frames;
+	for (size_t i = 0; i < frames.size(); ++i) {
+		// a later file with the same frame number replaces the earlier one
+		if (i + 1 < frames.size() && frames[i + 1].index == frames[i].index) {
+			continue;
 		}
+		sprite.assets.push_back(AssetBit());
+		sprite.assets.back().path = frames[i].path;
+		applyPlacement(frames[i].placement, sprite.assets.back());
+	}
+	return AbstractAssetsParser::createFileSprite(&sprite);
+}
+
+const Placement* DirectoryParser::findPlacement (const QString& path) const
+{
+	if (!_placements) {
+		return NULL;
+	}
+	QHash<QString, Placement>::const_iterator found = _placements->files.constFind(path);
+	return found != _placements->files.constEnd() ? &found.value() : NULL;
+}
+
+const Placement* DirectoryParser::findPlacement (const QByteArray& name) const
+{
+	if (!_placements) {
+		return NULL;
+	}
+	QHash<QByteArray, Placement>::const_iterator found = _placements->classes.constFind(name);
+	return found != _placements->classes.constEnd() ? &found.value() : NULL;
+}
+
+// without a placement the properties are left empty and the templates fall back to their defaults
+void DirectoryParser::applyPlacement (const Placement* placement, AssetBit& asset)
+{
+	if (placement) {
+		asset.x = placement->x;
+		asset.y = placement->y;
+		asset.alpha = placement->alpha;
+		asset.visible = placement->visible;
 	} else {
-		createFileCommon(name, _tempDir.relativeFilePath(fileInfo.filePath()));
+		asset.x.clear();
+		asset.y.clear();
+		asset.alpha.clear();
+		asset.visible.clear();
 	}
 }
 
-void DirectoryParser::parseSpriteImageList (const QString& name, const Content::Class clazz)
+bool DirectoryParser::update (const DirectoryWatcher::ChangeList& changes)
 {
-	QRegExp regExp;
-	switch (clazz) {
-	case Content::SPRITE:
-		regExp = _regExpMc;
-		break;
-	case Content::MOVIECLIP:
-		regExp = _regExpSp;
-		break;
-	case Content::UNDEFINED:
-	default:
-		warning("undefined class type for " + name);
-		return;
+	if (!_tree) {
+		return false;
 	}
 
-	SpriteAsset sprite;
-	const QRegExp rx(QString(name).replace(regExp, regExp.pattern()));
+	QElapsedTimer etime;
+	etime.start();
+	const CompileList previous = _compileList;
+	bool modified = false;
+	bool classesChanged = false;
+	bool created = false;
 
-	for (int i = 0; i < _currDirList.size(); ++i) {
-		const QFileInfo fileInfo = _currDirList.at(i);
-		const QString fname = fileInfo.fileName();
+	for (DirectoryWatcher::ChangeListConstIter i = changes.constBegin(); i != changes.constEnd(); ++i) {
+		DirectoryWalker::Node* node = _nodes.value(i.key());
+		if (node) {
+			modified |= updateNode(node, i.value(), &classesChanged);
+		}
+	}
 
-		int index = 0;
-		if (fileInfo.isFile() && (index = rx.indexIn(fname)) > -1) {
-			if (fname.at(index + rx.matchedLength()).digitValue() > 0) {
-				continue;
-			}
-			const int ri = regExp.indexIn(fname);
-			const int rm = regExp.matchedLength();
-			const QString matched = fname.mid(ri, rm);
-			const int ni = REGEXP_DIGITS.indexIn(matched);
-			const int nm = REGEXP_DIGITS.matchedLength();
-			const unsigned int index = matched.mid(ni, nm).toInt();
-			AssetBit asset;
-			asset.path = _tempDir.relativeFilePath(fileInfo.filePath());
-			if (sprite.assets.size() < index + 1) {
-				sprite.assets.resize(index + 1);
-			}
-			sprite.assets[index] = asset;
+	_compileList = previous;
+	if (classesChanged) {
+		_compileList.clear();
+		collectClasses(_tree, _compileList);
+		if (_compileList != previous) {
+			createMainClass();
+			created = true;
+		}
+	}
+	// holders list the path of every embed, a changed single asset may have moved
+	if (modified && !created && isConsolidate()) {
+		createMainClass();
+	}
+
+	if (modified) {
+		retainClassFiles();
+		removeStaleFiles();
+		info("update took " + QString::number(etime.elapsed() / (float) 1000) + " seconds");
+	}
+	return modified;
+}
+
+bool DirectoryParser::updateNode (DirectoryWalker::Node* node, const QSet<QString>& names, bool* classesChanged)
+{
+	DirectoryWalker::Node listed(node->path);
+	DirectoryWalker::listDirectory(&listed, &_ignore, &_matcher);
+	const DirectoryWalker::FileList& list = listed.files;
+	EntryList oldEntries;
+	EntryList newEntries;
+	FrameGroupList oldGroups;
+	FrameGroupList newGroups;
+	groupFrames(node, oldEntries, oldGroups);
+	groupFrames(&listed, newEntries, newGroups);
+
+	QSet<QString> affected;
+	collectAffected(node->files, oldEntries, names, affected);
+	collectAffected(list, newEntries, names, affected);
+	bool modified = !affected.isEmpty();
+
+	NodeIndex children;
+	size_t child = 0;
+	for (size_t i = 0; i < node->files.size(); ++i) {
+		if (oldEntries[i].group == ENTRY_DIR) {
+			children.insert(node->filePath(node->files[i]), node->children[child++]);
+		}
+	}
+
+	std::vector<DirectoryWalker::Node*> updated;
+	for (size_t i = 0; i < list.size(); ++i) {
+		if (newEntries[i].group != ENTRY_DIR) {
+			continue;
+		}
+		const QString path = listed.filePath(list[i]);
+		DirectoryWalker::Node* sub = children.take(path);
+		if (!sub) {
+			DirectoryWalker walker;
+			walker.setJobs(_jobs);
+			walker.setIgnoreMatcher(&_ignore);
+			walker.setNameMatcher(&_matcher);
+			walker.setKeepFiles(true);
+			sub = walker.walk(QDir(path));
+			DirectoryWalker::logListed(sub);
+			parse(sub);
+			indexNodes(sub);
+			*classesChanged = true;
+			modified = true;
+		}
+		updated.push_back(sub);
+	}
+
+	for (NodeIndex::const_iterator i = children.constBegin(); i != children.constEnd(); ++i) {
+		CompileList removed;
+		collectClasses(i.value(), removed);
+		for (CompileListConstIter c = removed.begin(); c != removed.end(); ++c) {
+			removeClassFile(QString::fromUtf8(*c));
+		}
+		unindexNodes(i.value());
+		delete i.value();
+		*classesChanged = true;
+		modified = true;
+	}
+
+	DirectoryWalker::FileList previous;
+	previous.swap(node->files);
+	node->files.swap(listed.files);
+	node->children = updated;
+
+	for (QSet<QString>::const_iterator i = affected.constBegin(); i != affected.constEnd(); ++i) {
+		const int before = findClass(previous, oldEntries, *i);
+		const int after = findClass(node->files, newEntries, *i);
+		if (after > -1) {
+			createEntryFile(node, newEntries, newGroups, after);
+		} else if (before > -1) {
+			removeClassFile(*i);
+		}
+		if ((before > -1) != (after > -1)) {
+			*classesChanged = true;
+		}
+	}
+	return modified;
+}
+
+void DirectoryParser::collectClasses (const DirectoryWalker::Node* node, CompileList& classes) const
+{
+	const DirectoryWalker::FileList& list = node->files;
+	EntryList entries;
+	FrameGroupList groups;
+	groupFrames(node, entries, groups);
+
+	size_t child = 0;
+	for (size_t i = 0; i < list.size(); ++i) {
+		const Entry& entry = entries[i];
+		if (entry.group == ENTRY_DIR) {
+			collectClasses(node->children[child++], classes);
+		} else if (entry.group >= 0) {
+			classes.push_back(entry.name.toUtf8());
+		} else if (entry.group == ENTRY_COMMON && File::getType(list[i].name) != File::UNSUPPORTED) {
+			classes.push_back(entry.name.toUtf8());
+		}
+	}
+}
+
+void DirectoryParser::collectAffected (const DirectoryWalker::FileList& list, const EntryList& entries,
+		const QSet<QString>& names, QSet<QString>& affected) const
+{
+	for (size_t i = 0; i < list.size(); ++i) {
+		if (entries[i].group == ENTRY_DIR) {
+			continue;
+		}
+		if (names.isEmpty() || names.contains(list[i].name)) {
+			affected.insert(entries[i].name);
+		}
+	}
+}
+
+int DirectoryParser::findClass (const DirectoryWalker::FileList& list, const EntryList& entries, const QString& name) const
+{
+	int found = -1;
+	for (size_t i = 0; i < list.size(); ++i) {
+		const Entry& entry = entries[i];
+		if (entry.name != name) {
+			continue;
 		}
+		if (entry.group >= 0 || (entry.group == ENTRY_COMMON && File::getType(list[i].name) != File::UNSUPPORTED)) {
+			found = int(i);
+		}
+	}
+	return found;
+}
+
+void DirectoryParser::removeClassFile (const QString& name) const
+{
+	const QString path = _tempDir.absoluteFilePath(name + Content::STR_DOT_AS);
+	if (QFile::remove(path)) {
+		info("removed: " + path);
+	}
+}
+
+void DirectoryParser::indexNodes (DirectoryWalker::Node* node)
+{
+	_nodes.insert(node->path, node);
+	for (std::vector<DirectoryWalker::Node*>::iterator i = node->children.begin(); i != node->children.end(); ++i) {
+		indexNodes(*i);
 	}
-	sprite.name = QString(name).remove(regExp);
-	sprite.clazz = clazz;
-	AbstractAssetsParser::createFileSprite(&sprite);
 }
 
-void DirectoryParser::removeIgnoredSuffix (QString& name) const
+void DirectoryParser::unindexNodes (const DirectoryWalker::Node* node)
 {
-	if (_suffixIgnorePattern.isEmpty())
-		return;
-	int index = name.lastIndexOf(_suffixIgnorePattern);
-	if (index > -1) {
-		name.replace(index, name.length() - index, "");
+	_nodes.remove(node->path);
+	for (std::vector<DirectoryWalker::Node*>::const_iterator i = node->children.begin(); i != node->children.end(); ++i) {
+		unindexNodes(*i);
 	}
 }
@@ -29,37 +29,140 @@
 #pragma once
 
 #include "AbstractAssetsParser.h"
+#include "DirectoryWalker.h"
+#include "IgnoreMatcher.h"
+#include "NameMatcher.h"
+#include "Placement.h"
+#include "ScanManifest.h"
+#include "common/BoundedQueue.h"
 #include "constants/Content.h"
+#include "ports/DirectoryWatcher.h"
 
+#include <vector>
+
+#include <QByteArray>
 #include <QDir>
-#include <QFileInfo>
-#include <QFileInfoList>
-#include <QRegExp>
+#include <QHash>
+#include <QSet>
 #include <QString>
 
-class DirectoryParser: public AbstractAssetsParser {
+/**
+ * Generates the asset classes of a directory tree. Listing and class generation run as a pipeline,
+ * the walker threads queue an asset job for every class as soon as its batch of entries is read
+ * while generator threads write the class files. Only the frames of a directory are held until its
+ * listing ends, and only the main class waits for the whole tree.
+ */
+class DirectoryParser: public AbstractAssetsParser, private DirectoryWalker::Visitor {
 public:
 	DirectoryParser ();
 	~DirectoryParser ();
 
-	void setMovieclipPattern (const QString& pattern);
-	void setSpritePattern (const QString& pattern);
+	bool setMovieclipPattern (const QString& pattern);
+	bool setSpritePattern (const QString& pattern);
 	void setSuffixIgnorePattern (const QString& pattern);
+	void setIncremental (bool incremental);
+	void setRescan (bool rescan);
+	void setPlacements (const PlacementIndex* placements);
 	void parse ();
+	bool update (const DirectoryWatcher::ChangeList& changes);
 
 protected:
-	void parse (QDir& dpath);
-	void removeIgnoredSuffix (QString& name) const;
-	void createAssetFile (const QFileInfo& fileInfo);
-	void parseSpriteImageList (const QString& name, const Content::Class clazz);
+	struct FrameFile {
+		unsigned int index;
+		QByteArray path;
+		const Placement* placement;
+
+		bool operator< (const FrameFile& other) const
+		{
+			return index < other.index;
+		}
+	};
+	typedef std::vector<FrameFile> FrameList;
+
+	struct FrameGroup {
+		Content::Class clazz;
+		QByteArray name;
+		FrameList frames;
+		const Placement* placement;
+		quint32 anchor;
+		bool anchored;
+	};
+	typedef std::vector<FrameGroup> FrameGroupList;
+	typedef QHash<QString, int> FrameGroupIndex;
+
+	// frame groups of the directory being read, filled one entry at a time
+	struct Grouping {
+		FrameGroupIndex movieclips;
+		FrameGroupIndex sprites;
+		FrameGroupList groups;
+	};
+	typedef QHash<QString, DirectoryWalker::Node*> NodeIndex;
+
+	struct Entry {
+		int group;
+		QString name;
+	};
+	typedef std::vector<Entry> EntryList;
+
+	struct AssetJob {
+		DirectoryWalker::Order order;
+		QByteArray name;
+		QByteArray path;
+		FrameGroup group;
+		bool sprite;
+	};
+	typedef BoundedQueue<AssetJob> AssetQueue;
+
+	struct Generated {
+		DirectoryWalker::Order order;
+		QByteArray name;
+
+		bool operator< (const Generated& other) const
+		{
+			return order < other.order;
+		}
+	};
+	typedef std::vector<Generated> GeneratedList;
+
+	void parse (const DirectoryWalker::Node* node);
+	void visit (const DirectoryWalker::Node* node, DirectoryWalker::Listing& listing);
+	void generate (GeneratedList* generated);
+	void makeCommonJob (const DirectoryWalker::Node* node, const DirectoryWalker::File& file, size_t index,
+			const QString& name, AssetJob* job) const;
+	void makeSpriteJob (const DirectoryWalker::Node* node, const FrameGroup& group, AssetJob* job) const;
+	bool makeJob (const DirectoryWalker::Node* node, const EntryList& entries, const FrameGroupList& groups, size_t index,
+			AssetJob* job) const;
+	void groupFrames (const DirectoryWalker::Node* node, EntryList& entries, FrameGroupList& groups) const;
+	int groupEntry (const DirectoryWalker::Node* node, const DirectoryWalker::File& file, size_t index, Grouping& grouping,
+			QString& name) const;
+	static void sortFrames (FrameGroupList& groups);
+	static void warnUnanchored (const FrameGroupList& groups);
+	const Placement* findPlacement (const QString& path) const;
+	const Placement* findPlacement (const QByteArray& name) const;
+	static void applyPlacement (const Placement* placement, AssetBit& asset);
+	bool createEntryFile (const DirectoryWalker::Node* node, const EntryList& entries, const FrameGroupList& groups,
+			size_t index);
+	bool createAssetFile (const AssetJob& job);
+	bool createSpriteFile (const FrameGroup& group);
+
+	bool updateNode (DirectoryWalker::Node* node, const QSet<QString>& names, bool* classesChanged);
+	void collectClasses (const DirectoryWalker::Node* node, CompileList& classes) const;
+	void collectAffected (const DirectoryWalker::FileList& list, const EntryList& entries, const QSet<QString>& names,
+			QSet<QString>& affected) const;
+	int findClass (const DirectoryWalker::FileList& list, const EntryList& entries, const QString& name) const;
+	void removeClassFile (const QString& name) const;
+	void indexNodes (DirectoryWalker::Node* node);
+	void unindexNodes (const DirectoryWalker::Node* node);
 
 private:
-	QRegExp _regExpMc;
-	QRegExp _regExpSp;
-	QRegExp _regExpMc0;
-	QRegExp _regExpSp0;
-	QString _suffixIgnorePattern;
-	QFileInfoList _currDirList;
+	NameMatcher _matcher;
+	IgnoreMatcher _ignore;
+	AssetQueue* _queue;
+	DirectoryWalker::Node* _tree;
+	NodeIndex _nodes;
+	const PlacementIndex* _placements;
+	bool _incremental;
+	bool _rescan;
 
 	bool _ignoreHidden;
 };
@@ -0,0 +1,411 @@
+/*
+ * DirectoryWalker.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DirectoryWalker.h"
+#include "IgnoreMatcher.h"
+#include "ScanManifest.h"
+#include "common/Logger.h"
+#include "ports/DirectoryReader.h"
+#include "ports/System.h"
+
+#include <thread>
+#include <utility>
+
+#include <QStringList>
+
+namespace {
+// entries read, stat'ed and handed to the visitor together while a directory is listed
+const int STAT_BATCH = 4096;
+}
+
+DirectoryWalker::Node::~Node ()
+{
+	for (std::vector<Node*>::iterator i = children.begin(); i != children.end(); ++i) {
+		delete *i;
+	}
+}
+
+QString DirectoryWalker::Node::filePath (const File& file) const
+{
+	return path.endsWith('/') ? path + file.name : path + '/' + file.name;
+}
+
+DirectoryWalker::DirectoryWalker () :
+	_queues(), _pending(0), _queued(0), _idleLock(), _idle(), _manifest(NULL), _writer(NULL), _ignore(NULL), _matcher(NULL),
+	_visitor(NULL), _jobs(1), _keepFiles(false)
+{
+}
+
+DirectoryWalker::~DirectoryWalker ()
+{
+}
+
+void DirectoryWalker::setJobs (int jobs)
+{
+	_jobs = jobs < 1 ? 1 : jobs;
+}
+
+void DirectoryWalker::setManifest (const ScanManifest* manifest)
+{
+	_manifest = manifest;
+}
+
+// the new manifest is written while the tree is listed, one record per batch
+void DirectoryWalker::setManifestWriter (ScanManifest* writer)
+{
+	_writer = writer;
+}
+
+// the entries are only needed again by the watch mode, otherwise they are dropped after their batch
+void DirectoryWalker::setKeepFiles (bool keep)
+{
+	_keepFiles = keep;
+}
+
+void DirectoryWalker::setIgnoreMatcher (const IgnoreMatcher* ignore)
+{
+	_ignore = ignore;
+}
+
+void DirectoryWalker::setNameMatcher (const NameMatcher* matcher)
+{
+	_matcher = matcher;
+}
+
+void DirectoryWalker::setVisitor (Visitor* visitor)
+{
+	_visitor = visitor;
+}
+
+DirectoryWalker::Node* DirectoryWalker::walk (const QDir& root)
+{
+	Node* tree = new Node(root.path());
+
+	for (int i = 0; i < _jobs; ++i) {
+		_queues.push_back(new Queue());
+	}
+	_pending = 1;
+	_queued = 1;
+	_queues[0]->nodes.push_back(tree);
+
+	std::vector<std::thread> workers;
+	for (int i = 1; i < _jobs; ++i) {
+		workers.push_back(std::thread(&DirectoryWalker::run, this, size_t(i)));
+	}
+	run(0);
+	for (std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i) {
+		i->join();
+	}
+
+	for (std::vector<Queue*>::iterator i = _queues.begin(); i != _queues.end(); ++i) {
+		delete *i;
+	}
+	_queues.clear();
+	return tree;
+}
+
+void DirectoryWalker::run (size_t worker)
+{
+	while (true) {
+		Node* node = pop(worker);
+		if (!node) {
+			node = steal(worker);
+		}
+		if (node) {
+			list(node, worker);
+			continue;
+		}
+		// sleeps until a directory is queued or the whole tree has been listed
+		std::unique_lock<std::mutex> guard(_idleLock);
+		_idle.wait(guard, [this] { return _queued > 0 || _pending == 0; });
+		if (_pending == 0) {
+			break;
+		}
+	}
+}
+
+// the idle lock is taken so a worker cannot miss the change between its check and its wait
+void DirectoryWalker::wake ()
+{
+	{
+		std::lock_guard<std::mutex> guard(_idleLock);
+	}
+	_idle.notify_all();
+}
+
+// the walk lists directories in any order, their log lines follow the serial order instead
+void DirectoryWalker::logListed (const Node* node)
+{
+	if (node->listed) {
+		info("parsing: " + node->path);
+	}
+	for (std::vector<Node*>::const_iterator i = node->children.begin(); i != node->children.end(); ++i) {
+		logListed(*i);
+	}
+}
+
+void DirectoryWalker::list (Node* node, size_t worker)
+{
+	FileStat stat;
+	if (System.getFileStat(node->path, &stat)) {
+		node->mtime = stat.mtime;
+		node->inode = stat.inode;
+		node->links = stat.links;
+	}
+
+	const ScanManifest::Directory* cached = _manifest ? _manifest->find(node->path) : NULL;
+	const bool trusted = cached && _manifest->isTrusted(*cached, node->mtime, node->inode, node->links);
+	node->listed = !trusted;
+
+	Listing listing(this, node, worker, trusted);
+	if (_visitor) {
+		_visitor->visit(node, listing);
+	}
+	listing.finish();
+
+	if (--_pending == 0) {
+		wake();
+	}
+}
+
+void DirectoryWalker::enqueue (size_t worker, const std::vector<Node*>& nodes)
+{
+	_pending += nodes.size();
+	Queue* queue = _queues[worker];
+	{
+		std::lock_guard<std::mutex> guard(queue->lock);
+		for (std::vector<Node*>::const_reverse_iterator i = nodes.rbegin(); i != nodes.rend(); ++i) {
+			queue->nodes.push_back(*i);
+		}
+		_queued += nodes.size();
+	}
+	wake();
+}
+
+void DirectoryWalker::listDirectory (Node* node, const IgnoreMatcher* ignore, const NameMatcher* matcher)
+{
+	node->files.clear();
+	DirectoryReader reader;
+	if (!reader.open(node->path)) {
+		return;
+	}
+
+	QStringList names;
+	while (readNames(reader, names)) {
+		statFiles(node->path, names, ignore, matcher, node->files);
+	}
+}
+
+// names arrive sorted from the reader, at most one batch of them at a time
+bool DirectoryWalker::readNames (DirectoryReader& reader, QStringList& names)
+{
+	names.clear();
+	QString name;
+	while (names.size() < STAT_BATCH && reader.next(name)) {
+		names.append(name);
+	}
+	return !names.isEmpty();
+}
+
+/**
+ * Names the ignore rules exclude whether they are a file or a directory are dropped before anything
+ * is stat'ed, only the rules limited to directories wait for the stat to tell which one a name is.
+ */
+void DirectoryWalker::statFiles (const QString& dir, const QStringList& names, const IgnoreMatcher* ignore,
+		const NameMatcher* matcher, FileList& files)
+{
+	const bool rules = ignore && !ignore->isEmpty();
+	QStringList kept;
+	QStringList paths;
+	// whether the name is ignored as a file and as a directory
+	std::vector<std::pair<bool, bool> > ignored;
+	kept.reserve(names.size());
+	paths.reserve(names.size());
+	ignored.reserve(names.size());
+	for (QStringList::const_iterator i = names.constBegin(); i != names.constEnd(); ++i) {
+		const QString path = dir.endsWith('/') ? dir + *i : dir + '/' + *i;
+		const bool asFile = rules && ignore->isIgnored(path, false);
+		const bool asDir = rules && ignore->isIgnored(path, true);
+		if (asFile && asDir) {
+			debug("ignoring: " + path);
+			continue;
+		}
+		kept.append(*i);
+		paths.append(path);
+		ignored.push_back(std::make_pair(asFile, asDir));
+	}
+	FileStatList stats;
+	System.getFileStats(paths, stats);
+
+	for (int i = 0; i < kept.size(); ++i) {
+		const FileStat& stat = stats[i];
+		if (!stat.exists) {
+			continue;
+		}
+		File file;
+		file.name = kept.at(i);
+		file.dir = stat.dir;
+		if (file.dir ? ignored[i].second : ignored[i].first) {
+			debug("ignoring: " + paths.at(i));
+			continue;
+		}
+		file.size = file.dir ? 0 : stat.size;
+		file.mtime = stat.mtime;
+		if (file.dir || !matcher) {
+			file.match.clazz = Content::UNDEFINED;
+			file.match.frame = 0;
+			file.match.begin = 0;
+			file.match.end = file.name.length();
+		} else {
+			matcher->classify(file.name, &file.match);
+		}
+		files.push_back(file);
+	}
+}
+
+DirectoryWalker::Listing::Listing (DirectoryWalker* walker, Node* node, size_t worker, bool cached) :
+	_walker(walker), _node(node), _worker(worker), _reader(), _manifestFile(), _chunk(0), _index(0), _cached(cached),
+	_done(false), _failed(false)
+{
+	if (!_cached && !_reader.open(node->path)) {
+		_done = true;
+	}
+}
+
+/**
+ * Fills the next batch of entries, false once the directory has no more. Every batch is recorded in
+ * the new manifest and its sub directories are queued before it is returned.
+ */
+bool DirectoryWalker::Listing::next (FileList& files)
+{
+	files.clear();
+	while (files.empty() && !_done) {
+		if (!read(files)) {
+			_done = true;
+		}
+	}
+	if (files.empty()) {
+		return false;
+	}
+
+	std::vector<Node*> children;
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (files[i].dir) {
+			Node* child = new Node(_node->filePath(files[i]));
+			child->order = _node->order;
+			child->order.push_back(_index + quint32(i));
+			children.push_back(child);
+		}
+	}
+	_index += quint32(files.size());
+	_node->children.insert(_node->children.end(), children.begin(), children.end());
+	if (!children.empty()) {
+		_walker->enqueue(_worker, children);
+	}
+
+	if (_walker->_keepFiles) {
+		_node->files.insert(_node->files.end(), files.begin(), files.end());
+	}
+	if (_walker->_writer && _node->mtime != 0) {
+		_walker->_writer->write(_node->path, _node->mtime, _node->inode, _node->links, files, false);
+	}
+	return true;
+}
+
+bool DirectoryWalker::Listing::read (FileList& files)
+{
+	if (_cached) {
+		if (_walker->_manifest->read(_manifestFile, _node->path, _chunk, files)) {
+			++_chunk;
+			return true;
+		}
+		if (_chunk >= _walker->_manifest->getChunkCount(_node->path)) {
+			return false;
+		}
+		// entries already handed out cannot be taken back, the directory is left out of the new manifest
+		if (_chunk > 0) {
+			warning("cannot read the manifest record of " + _node->path + ", it is listed again on the next run");
+			_failed = true;
+			return false;
+		}
+		_cached = false;
+		_node->listed = true;
+		if (!_reader.open(_node->path)) {
+			return false;
+		}
+	}
+
+	QStringList names;
+	if (!readNames(_reader, names)) {
+		return false;
+	}
+	statFiles(_node->path, names, _walker->_ignore, _walker->_matcher, files);
+	return true;
+}
+
+// entries the visitor did not ask for still have to be walked and recorded
+void DirectoryWalker::Listing::finish ()
+{
+	FileList files;
+	while (next(files)) {
+	}
+	_reader.close();
+	_manifestFile.close();
+	if (_walker->_writer && _node->mtime != 0 && !_failed) {
+		_walker->_writer->write(_node->path, _node->mtime, _node->inode, _node->links, FileList(), true);
+	}
+}
+
+DirectoryWalker::Node* DirectoryWalker::pop (size_t worker)
+{
+	Queue* queue = _queues[worker];
+	std::lock_guard<std::mutex> guard(queue->lock);
+	if (queue->nodes.empty()) {
+		return NULL;
+	}
+	Node* node = queue->nodes.back();
+	queue->nodes.pop_back();
+	--_queued;
+	return node;
+}
+
+DirectoryWalker::Node* DirectoryWalker::steal (size_t worker)
+{
+	const size_t count = _queues.size();
+	for (size_t n = 1; n < count; ++n) {
+		Queue* queue = _queues[(worker + n) % count];
+		std::lock_guard<std::mutex> guard(queue->lock);
+		if (!queue->nodes.empty()) {
+			Node* node = queue->nodes.front();
+			queue->nodes.pop_front();
+			--_queued;
+			return node;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,177 @@
+/*
+ * DirectoryWalker.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "NameMatcher.h"
+#include "ports/DirectoryReader.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+class IgnoreMatcher;
+class ScanManifest;
+
+/**
+ * Lists a directory tree with a pool of workers. Every worker owns a queue of directories
+ * it still has to list, new sub directories are pushed to the back of the owning queue and
+ * idle workers steal from the front of the queues of the others. The entries of a directory are
+ * handed to the visitor in sorted batches of a fixed size and are only kept in the tree when
+ * asked to, the tree itself holds the directories in the order of a serial walk. Entries excluded
+ * by the ignore rules are dropped while listing, ignored sub trees are never read.
+ */
+class DirectoryWalker {
+public:
+	struct File {
+		QString name;
+		qint64 size;
+		qint64 mtime;
+		bool dir;
+		// classified once while listing and kept in the manifest with the entry
+		NameMatcher::Match match;
+	};
+	typedef std::vector<File> FileList;
+	// entry indices from the root down to a node, comparing two orders gives the serial walk order
+	typedef std::vector<quint32> Order;
+
+	struct Node {
+		QString path;
+		FileList files;
+		std::vector<Node*> children;
+		Order order;
+		qint64 mtime;
+		quint64 inode;
+		quint64 links;
+		// read from disk rather than taken from the manifest
+		bool listed;
+
+		explicit Node (const QString& dir) :
+			path(dir), files(), children(), order(), mtime(0), inode(0), links(0), listed(false)
+		{
+		}
+		~Node ();
+
+		QString filePath (const File& file) const;
+	};
+
+	/**
+	 * Sorted entries of one directory, read from disk or from the manifest one batch at a time.
+	 * Sub directories are queued for the walk as soon as their batch has been read.
+	 */
+	class Listing {
+	private:
+		Listing (const Listing&);
+		Listing& operator= (const Listing&);
+
+	public:
+		bool next (FileList& files);
+
+	private:
+		friend class DirectoryWalker;
+
+		Listing (DirectoryWalker* walker, Node* node, size_t worker, bool cached);
+		bool read (FileList& files);
+		void finish ();
+
+		DirectoryWalker* _walker;
+		Node* _node;
+		size_t _worker;
+		DirectoryReader _reader;
+		QFile _manifestFile;
+		size_t _chunk;
+		quint32 _index;
+		bool _cached;
+		bool _done;
+		bool _failed;
+	};
+
+	/**
+	 * Called from the worker threads as soon as a directory has been opened, the visitor reads its
+	 * entries from the listing.
+	 */
+	class Visitor {
+	public:
+		virtual ~Visitor ()
+		{
+		}
+		virtual void visit (const Node* node, Listing& listing) = 0;
+	};
+
+	DirectoryWalker ();
+	~DirectoryWalker ();
+
+	void setJobs (int jobs);
+	void setManifest (const ScanManifest* manifest);
+	void setManifestWriter (ScanManifest* writer);
+	void setKeepFiles (bool keep);
+	void setIgnoreMatcher (const IgnoreMatcher* ignore);
+	void setNameMatcher (const NameMatcher* matcher);
+	void setVisitor (Visitor* visitor);
+	Node* walk (const QDir& root);
+
+	static void logListed (const Node* node);
+
+	static void listDirectory (Node* node, const IgnoreMatcher* ignore = NULL, const NameMatcher* matcher = NULL);
+
+private:
+	struct Queue {
+		std::mutex lock;
+		std::deque<Node*> nodes;
+	};
+
+	void run (size_t worker);
+	void list (Node* node, size_t worker);
+	Node* pop (size_t worker);
+	Node* steal (size_t worker);
+	void wake ();
+	void enqueue (size_t worker, const std::vector<Node*>& nodes);
+	static bool readNames (DirectoryReader& reader, QStringList& names);
+	static void statFiles (const QString& dir, const QStringList& names, const IgnoreMatcher* ignore,
+			const NameMatcher* matcher, FileList& files);
+
+	std::vector<Queue*> _queues;
+	std::atomic<size_t> _pending;
+	std::atomic<size_t> _queued;
+	std::mutex _idleLock;
+	std::condition_variable _idle;
+	const ScanManifest* _manifest;
+	ScanManifest* _writer;
+	const IgnoreMatcher* _ignore;
+	const NameMatcher* _matcher;
+	Visitor* _visitor;
+	int _jobs;
+	bool _keepFiles;
+};
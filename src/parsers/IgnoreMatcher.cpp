@@ -0,0 +1,280 @@
+/*
+ * IgnoreMatcher.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "IgnoreMatcher.h"
+#include "common/Logger.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QList>
+
+const char* IgnoreMatcher::FILE_NAME = ".createswfignore";
+
+IgnoreMatcher::IgnoreMatcher () :
+	_rules(), _root(), _source()
+{
+}
+
+IgnoreMatcher::~IgnoreMatcher ()
+{
+}
+
+bool IgnoreMatcher::load (const QDir& root)
+{
+	_rules.clear();
+	_source.clear();
+	_root = root.path();
+
+	QFile file(root.filePath(FILE_NAME));
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		return false;
+	}
+	_source = file.readAll();
+	file.close();
+
+	const QList<QByteArray> lines = _source.split('\n');
+	for (QList<QByteArray>::const_iterator i = lines.constBegin(); i != lines.constEnd(); ++i) {
+		addRule(QString::fromUtf8(*i));
+	}
+	info("using " + QString::number(_rules.size()) + " ignore rules from " + file.fileName());
+	return true;
+}
+
+void IgnoreMatcher::addRule (const QString& line)
+{
+	QString glob = line;
+	while (glob.endsWith(' ') && !glob.endsWith("\\ ")) {
+		glob.chop(1);
+	}
+	if (glob.isEmpty() || glob.startsWith('#')) {
+		return;
+	}
+
+	Rule rule;
+	rule.negated = glob.startsWith('!');
+	if (rule.negated) {
+		glob.remove(0, 1);
+	} else if (glob.startsWith("\\#") || glob.startsWith("\\!")) {
+		glob.remove(0, 1);
+	}
+	rule.dirOnly = glob.endsWith('/');
+	if (rule.dirOnly) {
+		glob.chop(1);
+	}
+	// a slash anywhere but at the end anchors the glob to the target directory
+	rule.anchored = glob.contains('/');
+	if (glob.startsWith('/')) {
+		glob.remove(0, 1);
+	}
+	if (glob.isEmpty()) {
+		return;
+	}
+
+	compile(glob, rule.tokens);
+	_rules.push_back(rule);
+}
+
+bool IgnoreMatcher::isEmpty () const
+{
+	return _rules.empty();
+}
+
+bool IgnoreMatcher::isIgnored (const QString& path, bool dir) const
+{
+	if (_rules.empty()) {
+		return false;
+	}
+
+	int begin = 0;
+	if (path.startsWith(_root)) {
+		begin = _root.length();
+		if (begin < path.length() && path.at(begin) == '/') {
+			++begin;
+		}
+	}
+	const int end = path.length();
+	const int name = path.lastIndexOf('/') + 1;
+	const QChar* data = path.constData();
+
+	bool ignored = false;
+	for (RuleList::const_iterator i = _rules.begin(); i != _rules.end(); ++i) {
+		// only rules that would flip the current state need to be matched
+		if (i->negated != ignored || (i->dirOnly && !dir)) {
+			continue;
+		}
+		const int from = i->anchored ? begin : (name > begin ? name : begin);
+		if (matchTokens(i->tokens, 0, data, from, end)) {
+			ignored = !i->negated;
+		}
+	}
+	return ignored;
+}
+
+QByteArray IgnoreMatcher::getFingerprint () const
+{
+	return _source.isEmpty() ? QByteArray() : QCryptographicHash::hash(_source, QCryptographicHash::Sha1);
+}
+
+void IgnoreMatcher::compile (const QString& glob, TokenList& tokens)
+{
+	const int length = glob.length();
+	for (int i = 0; i < length; ++i) {
+		const QChar c = glob.at(i);
+		Token token;
+		token.negated = false;
+
+		if (c == '*') {
+			const bool atStart = i == 0 || glob.at(i - 1) == '/';
+			if (i + 1 < length && glob.at(i + 1) == '*' && atStart) {
+				if (i + 2 == length) {
+					token.type = ANY_PATH;
+					++i;
+				} else if (glob.at(i + 2) == '/') {
+					token.type = ANY_DIRS;
+					i += 2;
+				} else {
+					token.type = ANY_NAME;
+					++i;
+				}
+			} else {
+				token.type = ANY_NAME;
+			}
+			while (token.type == ANY_NAME && i + 1 < length && glob.at(i + 1) == '*') {
+				++i;
+			}
+		} else if (c == '?') {
+			token.type = ANY_CHAR;
+		} else if (c == '[' && classEnd(glob, i) > 0) {
+			token.type = CHAR_CLASS;
+			const int close = classEnd(glob, i);
+			int j = i + 1;
+			if (glob.at(j) == '!' || glob.at(j) == '^') {
+				token.negated = true;
+				++j;
+			}
+			for (; j < close; ++j) {
+				const QChar from = glob.at(j);
+				QChar to = from;
+				if (j + 2 < close && glob.at(j + 1) == '-') {
+					to = glob.at(j + 2);
+					j += 2;
+				}
+				token.text.append(from);
+				token.text.append(to);
+			}
+			i = close;
+		} else {
+			if (c == '\\' && i + 1 < length) {
+				++i;
+			}
+			if (!tokens.empty() && tokens.back().type == LITERAL) {
+				tokens.back().text.append(glob.at(i));
+				continue;
+			}
+			token.type = LITERAL;
+			token.text = glob.at(i);
+		}
+		tokens.push_back(token);
+	}
+}
+
+int IgnoreMatcher::classEnd (const QString& glob, int open)
+{
+	int i = open + 1;
+	if (i < glob.length() && (glob.at(i) == '!' || glob.at(i) == '^')) {
+		++i;
+	}
+	// the first character of a class may be a closing bracket
+	return i < glob.length() ? glob.indexOf(']', i + 1) : -1;
+}
+
+bool IgnoreMatcher::matchTokens (const TokenList& tokens, size_t token, const QChar* path, int pos, int end)
+{
+	for (; token < tokens.size(); ++token) {
+		const Token& t = tokens[token];
+		switch (t.type) {
+		case LITERAL: {
+			const int length = t.text.length();
+			if (end - pos < length) {
+				return false;
+			}
+			for (int i = 0; i < length; ++i) {
+				if (path[pos + i] != t.text.at(i)) {
+					return false;
+				}
+			}
+			pos += length;
+			break;
+		}
+		case ANY_CHAR:
+			if (pos >= end || path[pos] == '/') {
+				return false;
+			}
+			++pos;
+			break;
+		case CHAR_CLASS:
+			if (pos >= end || path[pos] == '/' || !matchClass(t, path[pos])) {
+				return false;
+			}
+			++pos;
+			break;
+		case ANY_NAME:
+			for (int i = pos; i <= end; ++i) {
+				if (matchTokens(tokens, token + 1, path, i, end)) {
+					return true;
+				}
+				if (i < end && path[i] == '/') {
+					break;
+				}
+			}
+			return false;
+		case ANY_PATH:
+			return true;
+		case ANY_DIRS:
+			if (matchTokens(tokens, token + 1, path, pos, end)) {
+				return true;
+			}
+			for (int i = pos; i < end; ++i) {
+				if (path[i] == '/' && matchTokens(tokens, token + 1, path, i + 1, end)) {
+					return true;
+				}
+			}
+			return false;
+		}
+	}
+	return pos == end;
+}
+
+bool IgnoreMatcher::matchClass (const Token& token, QChar c)
+{
+	bool found = false;
+	for (int i = 0; i + 1 < token.text.length() && !found; i += 2) {
+		found = c.unicode() >= token.text.at(i).unicode() && c.unicode() <= token.text.at(i + 1).unicode();
+	}
+	return found != token.negated;
+}
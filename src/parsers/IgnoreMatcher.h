@@ -0,0 +1,83 @@
+/*
+ * IgnoreMatcher.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <QByteArray>
+#include <QDir>
+#include <QString>
+
+/**
+ * Gitignore style exclusion rules read from a .createswfignore file in the target directory.
+ * Every glob is compiled once into a token list, isIgnored() then matches the path relative to the
+ * target directory against all rules and the last matching rule decides.
+ */
+class IgnoreMatcher {
+public:
+	static const char* FILE_NAME;
+
+	IgnoreMatcher ();
+	~IgnoreMatcher ();
+
+	bool load (const QDir& root);
+	void addRule (const QString& line);
+	bool isEmpty () const;
+	bool isIgnored (const QString& path, bool dir) const;
+	QByteArray getFingerprint () const;
+
+private:
+	enum TokenType {
+		LITERAL, ANY_CHAR, ANY_NAME, ANY_PATH, ANY_DIRS, CHAR_CLASS
+	};
+
+	struct Token {
+		TokenType type;
+		QString text;
+		bool negated;
+	};
+	typedef std::vector<Token> TokenList;
+
+	struct Rule {
+		TokenList tokens;
+		bool negated;
+		bool dirOnly;
+		bool anchored;
+	};
+	typedef std::vector<Rule> RuleList;
+
+	static void compile (const QString& glob, TokenList& tokens);
+	static int classEnd (const QString& glob, int open);
+	static bool matchTokens (const TokenList& tokens, size_t token, const QChar* path, int pos, int end);
+	static bool matchClass (const Token& token, QChar c);
+
+	RuleList _rules;
+	QString _root;
+	QByteArray _source;
+};
@@ -0,0 +1,243 @@
+/*
+ * NameMatcher.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "NameMatcher.h"
+
+#include <QCryptographicHash>
+
+namespace {
+const QString PATTERN_DIGITS = "\\d+";
+const QString PATTERN_SPECIAL = ".*+?[](){}|$^";
+const unsigned int MAX_FRAME = 0xffffff;
+
+typedef enum State {
+	PREFIX, DIGITS, SEPARATOR
+} State;
+
+bool appendLiteral (const QString& source, int from, int to, std::vector<ushort>& sequence)
+{
+	for (int i = from; i < to; ++i) {
+		QChar c = source.at(i);
+		if (c == '\\') {
+			if (++i == to) {
+				return false;
+			}
+			c = source.at(i);
+			if (c.isLetterOrNumber()) {
+				return false;
+			}
+		} else if (PATTERN_SPECIAL.contains(c)) {
+			return false;
+		}
+		sequence.push_back(c.unicode());
+	}
+	return true;
+}
+
+void appendSequence (const std::vector<ushort>& sequence, QByteArray& key)
+{
+	const quint32 size = quint32(sequence.size());
+	key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+	key.append(reinterpret_cast<const char*>(sequence.data()), int(size * sizeof(ushort)));
+}
+}
+
+NameMatcher::NameMatcher () :
+	_movieclip(), _sprite(), _suffix()
+{
+	_movieclip.enabled = false;
+	_sprite.enabled = false;
+}
+
+NameMatcher::~NameMatcher ()
+{
+}
+
+bool NameMatcher::setMovieclipPattern (const QString& pattern)
+{
+	return compile(pattern, &_movieclip);
+}
+
+bool NameMatcher::setSpritePattern (const QString& pattern)
+{
+	return compile(pattern, &_sprite);
+}
+
+void NameMatcher::setSuffixIgnorePattern (const QString& pattern)
+{
+	_suffix.clear();
+	for (int i = 0; i < pattern.length(); ++i) {
+		_suffix.push_back(pattern.at(i).unicode());
+	}
+}
+
+bool NameMatcher::compile (const QString& source, Pattern* pattern)
+{
+	pattern->prefix.clear();
+	pattern->separator.clear();
+	pattern->enabled = false;
+
+	if (source.isEmpty()) {
+		return true;
+	}
+
+	const int from = source.at(0) == '^' ? 1 : 0;
+	const int digits = source.indexOf(PATTERN_DIGITS, from);
+	if (digits < 0 || source.indexOf(PATTERN_DIGITS, digits + 1) > -1) {
+		return false;
+	}
+	if (!appendLiteral(source, from, digits, pattern->prefix)) {
+		return false;
+	}
+	if (!appendLiteral(source, digits + PATTERN_DIGITS.length(), source.length(), pattern->separator)) {
+		return false;
+	}
+	// the separator must not start with a digit, otherwise the frame number would be ambiguous
+	if (!pattern->separator.empty() && QChar(pattern->separator.front()).isDigit()) {
+		return false;
+	}
+	pattern->enabled = true;
+	return true;
+}
+
+// identifies the compiled patterns, classifications stored in a manifest are only reused for the same ones
+QByteArray NameMatcher::getFingerprint () const
+{
+	QByteArray key;
+	key.append(char(_movieclip.enabled));
+	appendSequence(_movieclip.prefix, key);
+	appendSequence(_movieclip.separator, key);
+	key.append(char(_sprite.enabled));
+	appendSequence(_sprite.prefix, key);
+	appendSequence(_sprite.separator, key);
+	appendSequence(_suffix, key);
+	return QCryptographicHash::hash(key, QCryptographicHash::Sha1);
+}
+
+void NameMatcher::classify (const QString& fileName, Match* match) const
+{
+	const QChar* name = fileName.constData();
+	int end = fileName.length();
+
+	for (int i = end - 1; i >= 0; --i) {
+		if (name[i] == '.') {
+			end = i;
+			break;
+		}
+	}
+
+	const int suffixLength = int(_suffix.size());
+	if (suffixLength > 0) {
+		for (int i = end - suffixLength; i >= 0; --i) {
+			int n = 0;
+			while (n < suffixLength && name[i + n].unicode() == _suffix[n]) {
+				++n;
+			}
+			if (n == suffixLength) {
+				end = i;
+				break;
+			}
+		}
+	}
+
+	match->end = end;
+	if (matchPattern(_movieclip, name, end, match)) {
+		match->clazz = Content::MOVIECLIP;
+	} else if (matchPattern(_sprite, name, end, match)) {
+		match->clazz = Content::SPRITE;
+	} else {
+		match->clazz = Content::UNDEFINED;
+		match->frame = 0;
+		match->begin = 0;
+	}
+}
+
+bool NameMatcher::matchPattern (const Pattern& pattern, const QChar* name, int end, Match* match)
+{
+	if (!pattern.enabled) {
+		return false;
+	}
+
+	const size_t prefixLength = pattern.prefix.size();
+	const size_t separatorLength = pattern.separator.size();
+	State state = prefixLength > 0 ? PREFIX : DIGITS;
+	unsigned int frame = 0;
+	size_t matched = 0;
+
+	for (int i = 0; i < end; ++i) {
+		const ushort c = name[i].unicode();
+		switch (state) {
+		case PREFIX:
+			if (c != pattern.prefix[matched]) {
+				return false;
+			}
+			if (++matched == prefixLength) {
+				state = DIGITS;
+				matched = 0;
+			}
+			break;
+		case DIGITS:
+			if (c >= '0' && c <= '9') {
+				frame = frame * 10 + (c - '0');
+				if (frame > MAX_FRAME) {
+					return false;
+				}
+				++matched;
+				break;
+			}
+			if (matched == 0) {
+				return false;
+			}
+			if (separatorLength == 0) {
+				match->frame = frame;
+				match->begin = i;
+				return true;
+			}
+			state = SEPARATOR;
+			matched = 0;
+			// fall through
+		case SEPARATOR:
+			if (c != pattern.separator[matched]) {
+				return false;
+			}
+			if (++matched == separatorLength) {
+				match->frame = frame;
+				match->begin = i + 1;
+				return true;
+			}
+			break;
+		}
+	}
+
+	if (state == DIGITS && matched > 0 && separatorLength == 0) {
+		match->frame = frame;
+		match->begin = end;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,77 @@
+/*
+ * NameMatcher.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "constants/Content.h"
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * Classifies asset file names against the movieclip/sprite frame patterns and the ignored suffix.
+ * Patterns are compiled once from the restricted form "^prefix\d+separator" into a prefix, digit
+ * and separator state machine, classify() then walks a file name once without allocating.
+ */
+class NameMatcher {
+public:
+	struct Match {
+		Content::Class clazz;
+		unsigned int frame;
+		int begin;
+		int end;
+	};
+
+	NameMatcher ();
+	~NameMatcher ();
+
+	bool setMovieclipPattern (const QString& pattern);
+	bool setSpritePattern (const QString& pattern);
+	void setSuffixIgnorePattern (const QString& pattern);
+
+	void classify (const QString& fileName, Match* match) const;
+	QByteArray getFingerprint () const;
+
+private:
+	typedef std::vector<ushort> Sequence;
+
+	struct Pattern {
+		Sequence prefix;
+		Sequence separator;
+		bool enabled;
+	};
+
+	static bool compile (const QString& source, Pattern* pattern);
+	static bool matchPattern (const Pattern& pattern, const QChar* name, int end, Match* match);
+
+	Pattern _movieclip;
+	Pattern _sprite;
+	Sequence _suffix;
+};
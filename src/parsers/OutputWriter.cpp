@@ -0,0 +1,147 @@
+/*
+ * OutputWriter.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "OutputWriter.h"
+#include "common/Logger.h"
+#include "constants/Content.h"
+#include "ports/System.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include <QFile>
+#include <QStringList>
+
+namespace {
+// initial capacity of a render buffer, enough for every class but large sprites
+const int BUFFER_SIZE = 16 * 1024;
+
+const QString TEMP_SUFFIX = ".tmp";
+}
+
+OutputWriter::OutputWriter () :
+	_header(), _headerStart(), _headerEnd(), _lock(), _written(), _keepWorkspace(false)
+{
+}
+
+OutputWriter::~OutputWriter ()
+{
+}
+
+void OutputWriter::setHeader (const QString& header, const QString& date)
+{
+	_header = header.toUtf8();
+	const QByteArray stamp = date.toUtf8();
+	const int at = stamp.isEmpty() ? -1 : _header.lastIndexOf(stamp);
+	_headerStart = at < 0 ? _header : _header.left(at);
+	_headerEnd = at < 0 ? QByteArray() : _header.mid(at + stamp.size());
+}
+
+void OutputWriter::setKeepWorkspace (bool keep)
+{
+	_keepWorkspace = keep;
+}
+
+QByteArray& OutputWriter::getBuffer () const
+{
+	static thread_local QByteArray buffer;
+	// a reserved buffer keeps its memory when it is resized to zero
+	buffer.reserve(std::max(buffer.capacity(), BUFFER_SIZE));
+	buffer.resize(0);
+	return buffer;
+}
+
+bool OutputWriter::write (const QString& path, const QByteArray& body) const
+{
+	if (!_keepWorkspace) {
+		if (!System.writeFile(path, _header, body)) {
+			error("failed to write file " + path);
+			return false;
+		}
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_written.insert(path);
+	}
+	if (isUnchanged(path, body)) {
+		debug("unchanged: " + path);
+		return true;
+	}
+	const QString temp = path + TEMP_SUFFIX;
+	if (!System.writeFile(temp, _header, body) || !System.replaceFile(temp, path)) {
+		error("failed to write file " + path);
+		QFile::remove(temp);
+		return false;
+	}
+	return true;
+}
+
+void OutputWriter::retain (const QString& path) const
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	if (_keepWorkspace) {
+		_written.insert(path);
+	}
+}
+
+void OutputWriter::removeStale (const QDir& dir) const
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	if (!_keepWorkspace) {
+		return;
+	}
+	const QStringList names = dir.entryList(QStringList("*" + Content::STR_DOT_AS), QDir::Files);
+	for (QStringList::const_iterator i = names.constBegin(); i != names.constEnd(); ++i) {
+		const QString path = dir.absoluteFilePath(*i);
+		if (!_written.contains(path) && QFile::remove(path)) {
+			info("removed: " + path);
+		}
+	}
+	_written.clear();
+}
+
+bool OutputWriter::isUnchanged (const QString& path, const QByteArray& body) const
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	// every byte is compared but the date of the previous header, which has to stay on its line
+	const QByteArray content = file.readAll();
+	const int end = content.size() - _headerEnd.size() - body.size();
+	if (end < _headerStart.size() || (_headerEnd.isEmpty() && end != _headerStart.size())) {
+		return false;
+	}
+	const int newline = content.indexOf('\n', _headerStart.size());
+	return (newline < 0 || newline >= end)
+			&& memcmp(content.constData(), _headerStart.constData(), _headerStart.size()) == 0
+			&& memcmp(content.constData() + end, _headerEnd.constData(), _headerEnd.size()) == 0
+			&& memcmp(content.constData() + end + _headerEnd.size(), body.constData(), body.size()) == 0;
+}
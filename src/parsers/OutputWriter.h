@@ -0,0 +1,72 @@
+/*
+ * OutputWriter.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <mutex>
+
+#include <QByteArray>
+#include <QDir>
+#include <QSet>
+#include <QString>
+
+/**
+ * Writes generated class files. A class is rendered into a byte buffer owned by the calling
+ * thread that keeps its capacity from one class to the next, the file header and the buffer
+ * are then written with a single writev through the ports layer.
+ *
+ * In a kept workspace a file is only replaced, through a temporary file and a rename, when its
+ * content other than the generation date changed, so unchanged classes keep their modification
+ * time. Every file passed to write() or retain() is remembered until removeStale() deletes the
+ * classes not written.
+ */
+class OutputWriter {
+public:
+	OutputWriter ();
+	~OutputWriter ();
+
+	// date is the part of header that differs between runs
+	void setHeader (const QString& header, const QString& date);
+	void setKeepWorkspace (bool keep);
+	QByteArray& getBuffer () const;
+	bool write (const QString& path, const QByteArray& body) const;
+	// keeps a file that is still current without writing it
+	void retain (const QString& path) const;
+	void removeStale (const QDir& dir) const;
+
+private:
+	bool isUnchanged (const QString& path, const QByteArray& body) const;
+
+	QByteArray _header;
+	// the header split around its date
+	QByteArray _headerStart;
+	QByteArray _headerEnd;
+	mutable std::mutex _lock;
+	mutable QSet<QString> _written;
+	bool _keepWorkspace;
+};
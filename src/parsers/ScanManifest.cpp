@@ -0,0 +1,265 @@
+/*
+ * ScanManifest.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ScanManifest.h"
+#include "common/Logger.h"
+#include "ports/System.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+
+namespace {
+const quint32 MANIFEST_MAGIC = 0x43534d46;
+const quint32 MANIFEST_VERSION = 5;
+// mtimes closer than this to the scan start may hide a change made during the scan
+const qint64 RACY_MTIME_NS = 2000000000LL;
+}
+
+ScanManifest::ScanManifest () :
+	_dirs(), _path(), _timestamp(0), _fingerprint(), _out(), _stream(), _lock()
+{
+}
+
+// an uncommitted manifest is removed with its temporary file
+ScanManifest::~ScanManifest ()
+{
+}
+
+// only the record headers are read, the entries stay on disk until a listing asks for them
+bool ScanManifest::load (const QString& path)
+{
+	clear();
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_5_0);
+	quint32 magic;
+	quint32 version;
+	in >> magic >> version;
+	if (magic != MANIFEST_MAGIC || version != MANIFEST_VERSION) {
+		debug("ignoring manifest " + path);
+		return false;
+	}
+	in >> _timestamp >> _fingerprint;
+
+	while (!in.atEnd() && in.status() == QDataStream::Ok) {
+		QString dirPath;
+		qint64 mtime;
+		quint64 inode;
+		quint64 links;
+		quint8 last;
+		Chunk chunk;
+		in >> dirPath >> mtime >> inode >> links >> last >> chunk.count >> chunk.size;
+		if (in.status() != QDataStream::Ok) {
+			break;
+		}
+		chunk.offset = file.pos();
+		if (in.skipRawData(int(chunk.size)) != int(chunk.size)) {
+			in.setStatus(QDataStream::ReadPastEnd);
+			break;
+		}
+
+		DirectoryIndex::iterator found = _dirs.find(dirPath);
+		if (found == _dirs.end()) {
+			Directory directory;
+			directory.complete = false;
+			found = _dirs.insert(dirPath, directory);
+		}
+		found->mtime = mtime;
+		found->inode = inode;
+		found->links = links;
+		if (chunk.count > 0) {
+			found->chunks.push_back(chunk);
+		}
+		if (last) {
+			found->complete = true;
+		}
+	}
+
+	if (in.status() != QDataStream::Ok) {
+		warning("corrupt manifest " + path + ", rescanning");
+		clear();
+		return false;
+	}
+	_path = path;
+	return true;
+}
+
+void ScanManifest::clear ()
+{
+	_dirs.clear();
+	_path.clear();
+	_timestamp = 0;
+	_fingerprint.clear();
+}
+
+// records are written to a temporary file of this run that replaces the manifest once the walk is done
+bool ScanManifest::create (const QString& path)
+{
+	_path = path;
+	_out.setFileTemplate(path + ".XXXXXX");
+	if (!_out.open()) {
+		warning("cannot write manifest " + path);
+		return false;
+	}
+	_stream.setDevice(&_out);
+	_stream.setVersion(QDataStream::Qt_5_0);
+	_stream << MANIFEST_MAGIC << MANIFEST_VERSION << _timestamp << _fingerprint;
+	return true;
+}
+
+// called from the walker threads, the entries are serialized before the record is appended
+void ScanManifest::write (const QString& dir, qint64 mtime, quint64 inode, quint64 links,
+		const DirectoryWalker::FileList& files, bool last)
+{
+	QByteArray blob;
+	QDataStream entries(&blob, QIODevice::WriteOnly);
+	entries.setVersion(QDataStream::Qt_5_0);
+	for (DirectoryWalker::FileList::const_iterator f = files.begin(); f != files.end(); ++f) {
+		entries << f->name << f->size << f->mtime << f->dir << quint8(f->match.clazz) << f->match.frame
+				<< qint32(f->match.begin) << qint32(f->match.end);
+	}
+
+	std::lock_guard<std::mutex> guard(_lock);
+	if (!_out.isOpen()) {
+		return;
+	}
+	_stream << dir << mtime << inode << links << quint8(last) << quint32(files.size());
+	_stream.writeBytes(blob.constData(), uint(blob.size()));
+}
+
+bool ScanManifest::commit ()
+{
+	if (!_out.isOpen()) {
+		return false;
+	}
+	_stream.setDevice(NULL);
+	_out.close();
+	if (_out.error() != QFile::NoError || !System.replaceFile(_out.fileName(), _path)) {
+		return false;
+	}
+	_out.setAutoRemove(false);
+	return true;
+}
+
+void ScanManifest::setTimestamp (qint64 timestamp)
+{
+	_timestamp = timestamp;
+}
+
+void ScanManifest::setFingerprint (const QByteArray& fingerprint)
+{
+	_fingerprint = fingerprint;
+}
+
+const QByteArray& ScanManifest::getFingerprint () const
+{
+	return _fingerprint;
+}
+
+const ScanManifest::Directory* ScanManifest::find (const QString& path) const
+{
+	DirectoryIndex::const_iterator found = _dirs.constFind(path);
+	return found == _dirs.constEnd() ? NULL : &found.value();
+}
+
+bool ScanManifest::isTrusted (const Directory& directory, qint64 mtime, quint64 inode, quint64 links) const
+{
+	if (!directory.complete || mtime == 0 || directory.mtime != mtime || directory.inode != inode
+			|| directory.links != links) {
+		return false;
+	}
+	return mtime < _timestamp - RACY_MTIME_NS;
+}
+
+size_t ScanManifest::getChunkCount (const QString& path) const
+{
+	const Directory* directory = find(path);
+	return directory ? directory->chunks.size() : 0;
+}
+
+/**
+ * Reads the entries of one record of a directory. The file is opened on the first call and belongs
+ * to the caller, so listings on several threads read the manifest independently.
+ */
+bool ScanManifest::read (QFile& file, const QString& path, size_t chunk, DirectoryWalker::FileList& files) const
+{
+	const Directory* directory = find(path);
+	if (!directory || chunk >= directory->chunks.size()) {
+		return false;
+	}
+	if (!file.isOpen()) {
+		file.setFileName(_path);
+		if (!file.open(QIODevice::ReadOnly)) {
+			return false;
+		}
+	}
+
+	const Chunk& record = directory->chunks[chunk];
+	if (!file.seek(record.offset)) {
+		return false;
+	}
+	const QByteArray blob = file.read(record.size);
+	if (blob.size() != int(record.size)) {
+		return false;
+	}
+
+	QDataStream in(blob);
+	in.setVersion(QDataStream::Qt_5_0);
+	const size_t size = files.size();
+	files.reserve(size + record.count);
+	for (quint32 f = 0; f < record.count; ++f) {
+		DirectoryWalker::File entry;
+		quint8 clazz;
+		qint32 begin;
+		qint32 end;
+		in >> entry.name >> entry.size >> entry.mtime >> entry.dir >> clazz >> entry.match.frame >> begin >> end;
+		entry.match.clazz = Content::Class(clazz);
+		entry.match.begin = begin;
+		entry.match.end = end;
+		files.push_back(entry);
+	}
+	if (in.status() != QDataStream::Ok) {
+		files.resize(size);
+		return false;
+	}
+	return true;
+}
+
+QString ScanManifest::getManifestPath (const QDir& target)
+{
+	const QString dir = System.getHomeDir().path() + "/manifests/";
+	System.makeDir(dir);
+	const QByteArray key = target.absolutePath().toUtf8();
+	return dir + QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+}
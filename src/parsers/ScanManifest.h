@@ -0,0 +1,106 @@
+/*
+ * ScanManifest.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "DirectoryWalker.h"
+
+#include <mutex>
+#include <vector>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QTemporaryFile>
+
+/**
+ * Listing of a previous scan keyed by directory path. A directory whose mtime, inode and link
+ * count are unchanged since the last scan has the same entries, so its cached listing is reused
+ * instead of reading the directory again. The link count stands in for the number of entries, it is
+ * known from the stat alone where counting the entries would mean listing the directory. Entries keep the class they were classified as, so a reused listing
+ * is not classified again either.
+ *
+ * The file is a sequence of records, one per batch of a directory plus a closing record once the
+ * directory has been listed completely. Records are appended while the tree is walked and only an
+ * index of their offsets is loaded, the entries are read back one record at a time.
+ */
+class ScanManifest {
+private:
+	ScanManifest (const ScanManifest&);
+	ScanManifest& operator= (const ScanManifest&);
+
+public:
+	struct Chunk {
+		qint64 offset;
+		quint32 size;
+		quint32 count;
+	};
+
+	struct Directory {
+		qint64 mtime;
+		quint64 inode;
+		quint64 links;
+		std::vector<Chunk> chunks;
+		bool complete;
+	};
+
+	ScanManifest ();
+	~ScanManifest ();
+
+	bool load (const QString& path);
+	void clear ();
+
+	bool create (const QString& path);
+	void write (const QString& dir, qint64 mtime, quint64 inode, quint64 links, const DirectoryWalker::FileList& files,
+			bool last);
+	bool commit ();
+
+	void setTimestamp (qint64 timestamp);
+	void setFingerprint (const QByteArray& fingerprint);
+	const QByteArray& getFingerprint () const;
+	const Directory* find (const QString& path) const;
+	bool isTrusted (const Directory& directory, qint64 mtime, quint64 inode, quint64 links) const;
+	size_t getChunkCount (const QString& path) const;
+	bool read (QFile& file, const QString& path, size_t chunk, DirectoryWalker::FileList& files) const;
+
+	static QString getManifestPath (const QDir& target);
+
+private:
+	typedef QHash<QString, Directory> DirectoryIndex;
+
+	DirectoryIndex _dirs;
+	QString _path;
+	qint64 _timestamp;
+	QByteArray _fingerprint;
+	QTemporaryFile _out;
+	QDataStream _stream;
+	std::mutex _lock;
+};
@@ -0,0 +1,244 @@
+/*
+ * Template.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Template.h"
+#include "common/Logger.h"
+
+#include <QLatin1String>
+
+namespace {
+const char* const VARIABLE_NAMES[Template::VARIABLES] = {
+	"width", "height", "bgcolor", "fps", "name", "path", "mime", "count", "x", "y", "alpha", "visible", "arraytype"
+};
+
+const QLatin1String VAR_LOOP1("loop1");
+const QLatin1String VAR_LOOP2("loop2");
+}
+
+Template::Values::Values () :
+	optional(0)
+{
+}
+
+void Template::Values::set (Variable variable, StringView value, bool isOptional)
+{
+	text[variable] = value;
+	if (isOptional) {
+		optional |= 1u << variable;
+	} else {
+		optional &= ~(1u << variable);
+	}
+}
+
+Template::Template () :
+	_lines(), _renderer(NULL), _size(0)
+{
+}
+
+Template::Template (const LineData* lines, int count, Renderer renderer, int size) :
+	_lines(), _renderer(renderer), _size(size)
+{
+	_lines.resize(count);
+	for (int i = 0; i < count; ++i) {
+		_lines[i].loop = lines[i].loop;
+		_lines[i].compiled = lines[i].render;
+	}
+}
+
+Template::~Template ()
+{
+}
+
+void Template::addLine (const QString& source)
+{
+	Line line;
+	line.loop = NONE;
+	line.compiled = NULL;
+
+	int offset = 0;
+	int begin;
+	while ((begin = source.indexOf("${", offset)) > -1) {
+		// same as the former minimal match of \$\{.+\}
+		const int end = source.indexOf('}', begin + 3);
+		if (end < 0) {
+			break;
+		}
+		addLiteral(line, source.mid(offset, begin - offset));
+		offset = end + 1;
+
+		const QString name = source.mid(begin + 2, end - begin - 2);
+		if (name == VAR_LOOP1) {
+			line.loop = LOOP1;
+			continue;
+		}
+		if (name == VAR_LOOP2) {
+			line.loop = LOOP2;
+			continue;
+		}
+
+		int variable = 0;
+		while (variable < VARIABLES && name != QLatin1String(VARIABLE_NAMES[variable])) {
+			++variable;
+		}
+		const QString written = source.mid(begin, offset - begin);
+		if (variable == VARIABLES) {
+			warning("undefined variable " + written);
+			addLiteral(line, written);
+			continue;
+		}
+		Segment segment;
+		segment.text = written.toUtf8();
+		segment.variable = Variable(variable);
+		segment.literal = false;
+		line.segments.push_back(segment);
+	}
+	addLiteral(line, source.mid(offset));
+	_lines.push_back(line);
+	_size += source.length();
+}
+
+void Template::addLiteral (Line& line, const QString& text)
+{
+	if (text.isEmpty()) {
+		return;
+	}
+	if (!line.segments.empty() && line.segments.back().literal) {
+		line.segments.back().text.append(text.toUtf8());
+		return;
+	}
+	Segment segment;
+	segment.text = text.toUtf8();
+	segment.variable = VARIABLES;
+	segment.literal = true;
+	line.segments.push_back(segment);
+}
+
+void Template::save (QDataStream& out) const
+{
+	out << qint32(_size) << quint32(_lines.size());
+	for (LineListConstIter l = _lines.begin(); l != _lines.end(); ++l) {
+		out << quint8(l->loop) << quint32(l->segments.size());
+		for (std::vector<Segment>::const_iterator s = l->segments.begin(); s != l->segments.end(); ++s) {
+			out << quint8(s->variable) << s->text;
+		}
+	}
+}
+
+bool Template::load (QDataStream& in)
+{
+	qint32 size;
+	quint32 lineCount;
+	in >> size >> lineCount;
+	_lines.clear();
+	_size = size;
+	for (quint32 i = 0; i < lineCount && in.status() == QDataStream::Ok; ++i) {
+		quint8 loop;
+		quint32 segmentCount;
+		in >> loop >> segmentCount;
+		if (loop > LOOP2) {
+			return false;
+		}
+		Line line;
+		line.loop = Loop(loop);
+		line.compiled = NULL;
+		for (quint32 j = 0; j < segmentCount && in.status() == QDataStream::Ok; ++j) {
+			quint8 variable;
+			Segment segment;
+			in >> variable >> segment.text;
+			if (variable > VARIABLES) {
+				return false;
+			}
+			segment.variable = Variable(variable);
+			segment.literal = segment.variable == VARIABLES;
+			line.segments.push_back(segment);
+		}
+		_lines.push_back(line);
+	}
+	return in.status() == QDataStream::Ok;
+}
+
+const Template::LineList& Template::getLines () const
+{
+	return _lines;
+}
+
+int Template::getSize () const
+{
+	return _size;
+}
+
+void Template::render (const Values& values, QByteArray& out) const
+{
+	render(values, NULL, NULL, out);
+}
+
+void Template::render (const Values& values, Expander expand, const void* context, QByteArray& out) const
+{
+	if (_renderer) {
+		_renderer(*this, values, expand, context, out);
+		return;
+	}
+	for (LineListConstIter l = _lines.begin(); l != _lines.end(); ++l) {
+		if (expand && l->loop != NONE) {
+			expand(context, *l, out);
+		} else {
+			renderLine(*l, values, out);
+		}
+	}
+}
+
+void Template::renderLine (const Line& line, const Values& values, QByteArray& out)
+{
+	if (line.compiled) {
+		line.compiled(values, out);
+		return;
+	}
+	const int start = out.size();
+	for (std::vector<Segment>::const_iterator s = line.segments.begin(); s != line.segments.end(); ++s) {
+		if (s->literal) {
+			out.append(s->text);
+		} else if (!appendValue(values, s->variable, s->text.constData(), out)) {
+			out.truncate(start);
+			return;
+		}
+	}
+}
+
+bool Template::appendValue (const Values& values, Variable variable, const char* written, QByteArray& out)
+{
+	const StringView& value = values.text[variable];
+	if (value.isNull()) {
+		warning("undefined variable " + QString::fromUtf8(written));
+		out.append(written);
+	} else if (value.isEmpty() && (values.optional & (1u << variable))) {
+		return false;
+	} else {
+		out.append(value.data(), value.size());
+	}
+	return true;
+}
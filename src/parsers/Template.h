@@ -0,0 +1,127 @@
+/*
+ * Template.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "common/StringView.h"
+
+#include <vector>
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QString>
+
+/**
+ * An ActionScript template compiled once into lines of literal and variable segments.
+ * A line holding ${loop1} or ${loop2} is marked as a loop line, the renderer repeats it per
+ * item. Rendering appends each segment to a UTF-8 buffer in one pass without searching or editing
+ * the text. The built-in templates are generated into C++ functions instead, see getBuiltin.
+ */
+class Template {
+public:
+	enum Variable {
+		WIDTH, HEIGHT, BGCOLOR, FPS, NAME, PATH, MIME, COUNT, X, Y, ALPHA, VISIBLE, ARRAYTYPE, VARIABLES
+	};
+
+	enum Loop {
+		NONE, LOOP1, LOOP2
+	};
+
+	// text is UTF-8, a variable keeps its name as written for warnings
+	struct Segment {
+		QByteArray text;
+		Variable variable;
+		bool literal;
+	};
+
+	struct Values;
+	struct Line;
+	// a line generated by cmake/compile_templates.cmake
+	typedef void (*LineRenderer) (const Values& values, QByteArray& out);
+	// repeats a loop line per item
+	typedef void (*Expander) (const void* context, const Line& line, QByteArray& out);
+	// a whole template generated by cmake/compile_templates.cmake
+	typedef void (*Renderer) (const Template& compiled, const Values& values, Expander expand,
+			const void* context, QByteArray& out);
+
+	// segments are empty for a generated line
+	struct Line {
+		std::vector<Segment> segments;
+		Loop loop;
+		LineRenderer compiled;
+	};
+
+	typedef std::vector<Line> LineList;
+	typedef LineList::const_iterator LineListConstIter;
+
+	// UTF-8 values of a single render, an unset variable is written as is
+	struct Values {
+		Values ();
+		void set (Variable variable, StringView text, bool optional = false);
+
+		StringView text[VARIABLES];
+		// variables whose empty value drops the whole line
+		unsigned int optional;
+	};
+
+	// tables emitted at build time by cmake/compile_templates.cmake
+	struct LineData {
+		LineRenderer render;
+		Loop loop;
+	};
+
+	Template ();
+	Template (const LineData* lines, int count, Renderer renderer, int size);
+	~Template ();
+
+	// the templates of src/templates compiled into the binary, NULL for an unknown name
+	static const Template* getBuiltin (const QString& name);
+
+	void addLine (const QString& source);
+	const LineList& getLines () const;
+	// compiled lines in a binary form, see TemplateCache
+	void save (QDataStream& out) const;
+	bool load (QDataStream& in);
+	// bytes of the source, a hint for reserving the output
+	int getSize () const;
+
+	// loop lines are rendered once with values
+	void render (const Values& values, QByteArray& out) const;
+	// loop lines are passed to expand together with context
+	void render (const Values& values, Expander expand, const void* context, QByteArray& out) const;
+	static void renderLine (const Line& line, const Values& values, QByteArray& out);
+	// appends the value of variable, false when an optional empty value drops the line
+	static bool appendValue (const Values& values, Variable variable, const char* written, QByteArray& out);
+
+private:
+	static void addLiteral (Line& line, const QString& text);
+
+	LineList _lines;
+	Renderer _renderer;
+	int _size;
+};
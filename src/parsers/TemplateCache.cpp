@@ -0,0 +1,171 @@
+/*
+ * TemplateCache.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "TemplateCache.h"
+#include "common/Logger.h"
+#include "ports/System.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryFile>
+
+namespace {
+const quint32 CACHE_MAGIC = 0x43535754;
+// bump whenever Template::save or the parser changes
+const quint32 CACHE_VERSION = 3;
+const QString CACHE_DIR = "templates";
+const QString CACHE_SUFFIX = ".bin";
+}
+
+TemplateCache::TemplateCache () :
+	_dir(), _enabled(false), _templates()
+{
+}
+
+TemplateCache::~TemplateCache ()
+{
+	for (TemplateIndex::iterator i = _templates.begin(); i != _templates.end(); ++i) {
+		delete i->second;
+	}
+}
+
+void TemplateCache::setDirectory (const QDir& dir)
+{
+	_dir = dir;
+	_enabled = true;
+}
+
+const Template* TemplateCache::find (const QString& name)
+{
+	if (_enabled && _dir.exists(name)) {
+		TemplateIndex::const_iterator found = _templates.find(name);
+		if (found != _templates.end()) {
+			return found->second;
+		}
+		Template* compiled = open(_dir.absoluteFilePath(name));
+		if (compiled) {
+			_templates[name] = compiled;
+			return compiled;
+		}
+		warning("falling back to the built-in " + name);
+	}
+	return Template::getBuiltin(name);
+}
+
+Template* TemplateCache::open (const QString& path) const
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		warning("cannot read template " + path);
+		return NULL;
+	}
+	const QByteArray source = file.readAll();
+	file.close();
+
+	const QByteArray hash = QCryptographicHash::hash(source, QCryptographicHash::Sha1).toHex();
+	QDir cacheDir = System.getHomeDir();
+	cacheDir.mkpath(CACHE_DIR);
+	const QString cachePath = cacheDir.absoluteFilePath(CACHE_DIR + "/" + QString::fromLatin1(hash) + CACHE_SUFFIX);
+
+	Template* compiled = loadCompiled(cachePath);
+	if (compiled) {
+		debug("using compiled template " + cachePath + " for " + path);
+		return compiled;
+	}
+
+	info("compiling template " + path);
+	compiled = parse(source);
+	saveCompiled(cachePath, *compiled);
+	return compiled;
+}
+
+Template* TemplateCache::loadCompiled (const QString& path) const
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return NULL;
+	}
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_5_0);
+	quint32 magic;
+	quint32 version;
+	in >> magic >> version;
+	if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+		debug("ignoring compiled template " + path);
+		return NULL;
+	}
+
+	Template* compiled = new Template();
+	if (!compiled->load(in)) {
+		warning("corrupt compiled template " + path + ", recompiling");
+		delete compiled;
+		return NULL;
+	}
+	return compiled;
+}
+
+void TemplateCache::saveCompiled (const QString& path, const Template& compiled) const
+{
+	// unique per run, a fixed name would let concurrent runs interleave their writes
+	QTemporaryFile file(path + ".XXXXXX");
+	if (!file.open()) {
+		warning("cannot write compiled template " + path);
+		return;
+	}
+
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_5_0);
+	out << CACHE_MAGIC << CACHE_VERSION;
+	compiled.save(out);
+	file.close();
+
+	// concurrent runs write the same content, whichever rename lands last wins
+	if (out.status() == QDataStream::Ok && file.error() == QFile::NoError && System.replaceFile(file.fileName(), path)) {
+		file.setAutoRemove(false);
+	}
+}
+
+// splits the source into lines keeping their line feeds, like cmake/compile_templates.cmake
+Template* TemplateCache::parse (const QByteArray& source)
+{
+	QString text = QString::fromUtf8(source);
+	text.remove('\r');
+
+	Template* compiled = new Template();
+	int begin = 0;
+	while (begin < text.length()) {
+		int end = text.indexOf('\n', begin);
+		end = end < 0 ? text.length() : end + 1;
+		compiled->addLine(text.mid(begin, end - begin));
+		begin = end;
+	}
+	return compiled;
+}
@@ -0,0 +1,69 @@
+/*
+ * TemplateCache.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include "Template.h"
+
+#include <map>
+
+#include <QByteArray>
+#include <QDir>
+#include <QString>
+
+/**
+ * Templates of a user directory overriding the built-in ones by file name. A parsed template is
+ * kept in a binary form under the home directory keyed by the hash of its source, so an unchanged
+ * template is read back on later runs instead of being parsed again.
+ */
+class TemplateCache {
+private:
+	TemplateCache (const TemplateCache&);
+	TemplateCache& operator= (const TemplateCache&);
+
+public:
+	TemplateCache ();
+	~TemplateCache ();
+
+	void setDirectory (const QDir& dir);
+	// the user template of that name, the built-in one otherwise, NULL if neither exists
+	const Template* find (const QString& name);
+
+private:
+	typedef std::map<QString, Template*> TemplateIndex;
+
+	Template* open (const QString& path) const;
+	Template* loadCompiled (const QString& path) const;
+	void saveCompiled (const QString& path, const Template& compiled) const;
+	static Template* parse (const QByteArray& source);
+
+	QDir _dir;
+	bool _enabled;
+	TemplateIndex _templates;
+};
@@ -0,0 +1,337 @@
+/*
+ * BatchStat.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __WIN32__
+
+#include "BatchStat.h"
+#include "Unix.h"
+#include "common/Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <QFile>
+
+#if defined(__linux__) && defined(HAVE_IO_URING)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#endif
+
+namespace {
+// below this many paths a batch costs more than it saves
+const size_t MIN_BATCH = 16;
+const size_t THREAD_CHUNK = 256;
+// stat calls mostly wait on the filesystem, so more threads than cores still pay off
+const size_t LATENCY_THREADS = 16;
+
+#if defined(__linux__) && defined(HAVE_IO_URING)
+const unsigned RING_ENTRIES = 256;
+const unsigned STATX_FIELDS = STATX_TYPE | STATX_MODE | STATX_INO | STATX_NLINK | STATX_SIZE | STATX_MTIME;
+
+std::atomic<bool> uringDisabled(false);
+
+/**
+ * Submission and completion rings of one io_uring instance, mapped without liburing.
+ */
+class Ring {
+private:
+	Ring (const Ring&);
+	Ring& operator= (const Ring&);
+
+public:
+	Ring () :
+		_fd(-1), _sqPtr(MAP_FAILED), _sqSize(0), _cqPtr(MAP_FAILED), _cqSize(0), _sqes(NULL), _sqesSize(0),
+		_sqTail(NULL), _sqMask(NULL), _sqArray(NULL), _cqHead(NULL), _cqTail(NULL), _cqMask(NULL), _cqes(NULL),
+		_buffers(), _entries(0), _queued(0)
+	{
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		_fd = int(syscall(__NR_io_uring_setup, RING_ENTRIES, &params));
+		if (_fd < 0) {
+			return;
+		}
+
+		_sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single) {
+			_sqSize = _cqSize = std::max(_sqSize, _cqSize);
+		}
+
+		_sqPtr = mmap(NULL, _sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+		if (_sqPtr == MAP_FAILED) {
+			return;
+		}
+		if (!single) {
+			_cqPtr = mmap(NULL, _cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+			if (_cqPtr == MAP_FAILED) {
+				return;
+			}
+		}
+		_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED) {
+			return;
+		}
+		_sqes = static_cast<io_uring_sqe*>(sqes);
+
+		char* sq = static_cast<char*>(_sqPtr);
+		char* cq = static_cast<char*>(single ? _sqPtr : _cqPtr);
+		_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		_sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		_cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		_buffers.resize(params.sq_entries);
+		_entries = params.sq_entries;
+	}
+
+	~Ring ()
+	{
+		if (_sqes) {
+			munmap(_sqes, _sqesSize);
+		}
+		if (_cqPtr != MAP_FAILED) {
+			munmap(_cqPtr, _cqSize);
+		}
+		if (_sqPtr != MAP_FAILED) {
+			munmap(_sqPtr, _sqSize);
+		}
+		if (_fd >= 0) {
+			close(_fd);
+		}
+	}
+
+	bool isValid () const
+	{
+		return _entries > 0;
+	}
+
+	unsigned getEntries () const
+	{
+		return _entries;
+	}
+
+	const struct statx& getBuffer (unsigned slot) const
+	{
+		return _buffers[slot];
+	}
+
+	/**
+	 * Queues a statx of path into the given buffer slot, the slot is passed back to the completion handler.
+	 */
+	void prepareStatx (const char* path, unsigned slot)
+	{
+		const unsigned tail = *_sqTail + _queued;
+		const unsigned index = tail & *_sqMask;
+		io_uring_sqe* sqe = &_sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_STATX;
+		sqe->fd = AT_FDCWD;
+		sqe->addr = reinterpret_cast<unsigned long long>(path);
+		sqe->len = STATX_FIELDS;
+		sqe->off = reinterpret_cast<unsigned long long>(&_buffers[slot]);
+		sqe->user_data = slot;
+		_sqArray[index] = index;
+		++_queued;
+	}
+
+	/**
+	 * Submits the prepared entries and waits until all of them completed.
+	 */
+	template<typename Handler>
+	bool submitAndWait (Handler& handler)
+	{
+		const unsigned count = _queued;
+		__atomic_store_n(_sqTail, *_sqTail + count, __ATOMIC_RELEASE);
+		_queued = 0;
+
+		unsigned submit = count;
+		unsigned done = 0;
+		while (done < count) {
+			const int ret = int(syscall(__NR_io_uring_enter, _fd, submit, count - done, IORING_ENTER_GETEVENTS, NULL, 0));
+			if (ret < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			submit -= std::min(submit, unsigned(ret));
+
+			unsigned head = *_cqHead;
+			const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+			for (; head != tail; ++head, ++done) {
+				const io_uring_cqe& cqe = _cqes[head & *_cqMask];
+				handler(cqe.user_data, cqe.res);
+			}
+			__atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+		}
+		return true;
+	}
+
+private:
+	int _fd;
+	void* _sqPtr;
+	size_t _sqSize;
+	void* _cqPtr;
+	size_t _cqSize;
+	io_uring_sqe* _sqes;
+	size_t _sqesSize;
+	unsigned* _sqTail;
+	unsigned* _sqMask;
+	unsigned* _sqArray;
+	unsigned* _cqHead;
+	unsigned* _cqTail;
+	unsigned* _cqMask;
+	io_uring_cqe* _cqes;
+	// owned by the ring so that completions never write into memory of a finished call
+	std::vector<struct statx> _buffers;
+	unsigned _entries;
+	unsigned _queued;
+};
+
+struct StatxHandler {
+	const Ring* ring;
+	FileStatList* stats;
+	size_t offset;
+	bool unsupported;
+
+	void operator() (unsigned long long slot, int res)
+	{
+		FileStat& stat = (*stats)[offset + slot];
+		if (res == -EINVAL || res == -EOPNOTSUPP) {
+			unsupported = true;
+			stat.exists = false;
+			return;
+		}
+		stat.exists = res == 0;
+		if (!stat.exists) {
+			return;
+		}
+		const struct statx& stx = ring->getBuffer(unsigned(slot));
+		stat.size = qint64(stx.stx_size);
+		stat.mtime = qint64(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+		stat.inode = stx.stx_ino;
+		stat.links = stx.stx_nlink;
+		stat.dir = (stx.stx_mode & S_IFMT) == S_IFDIR;
+	}
+};
+#endif
+}
+
+void BatchStat::stat (const QStringList& paths, FileStatList& stats)
+{
+	PathList encoded;
+	encoded.reserve(paths.size());
+	for (QStringList::const_iterator i = paths.constBegin(); i != paths.constEnd(); ++i) {
+		encoded.push_back(QFile::encodeName(*i));
+	}
+	stats.resize(encoded.size());
+
+	if (encoded.size() < MIN_BATCH) {
+		statRange(&encoded, &stats, 0, encoded.size());
+	} else if (!statUring(encoded, stats)) {
+		statThreads(encoded, stats);
+	}
+}
+
+bool BatchStat::statUring (const PathList& paths, FileStatList& stats)
+{
+#if defined(__linux__) && defined(HAVE_IO_URING)
+	if (uringDisabled) {
+		return false;
+	}
+	// one ring per thread, the directory walker calls in from all of its workers
+	static thread_local Ring ring;
+	if (!ring.isValid()) {
+		if (!uringDisabled.exchange(true)) {
+			debug("io_uring is not available, using threads for stat batches");
+		}
+		return false;
+	}
+
+	StatxHandler handler;
+	handler.ring = &ring;
+	handler.stats = &stats;
+	handler.unsupported = false;
+
+	for (size_t offset = 0; offset < paths.size(); offset += ring.getEntries()) {
+		const size_t count = std::min(paths.size() - offset, size_t(ring.getEntries()));
+		for (size_t i = 0; i < count; ++i) {
+			ring.prepareStatx(paths[offset + i].constData(), unsigned(i));
+		}
+		handler.offset = offset;
+		if (!ring.submitAndWait(handler) || handler.unsupported) {
+			// kernels before 5.6 reject IORING_OP_STATX, finish this call and stop using the ring
+			uringDisabled = true;
+			statRange(&paths, &stats, offset, paths.size());
+			return true;
+		}
+	}
+	return true;
+#else
+	Q_UNUSED(paths);
+	Q_UNUSED(stats);
+	return false;
+#endif
+}
+
+void BatchStat::statThreads (const PathList& paths, FileStatList& stats)
+{
+	const size_t chunks = (paths.size() + THREAD_CHUNK - 1) / THREAD_CHUNK;
+	const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	const size_t count = std::min(chunks, std::max(cores, LATENCY_THREADS));
+	const size_t step = (paths.size() + count - 1) / count;
+
+	std::vector<std::thread> workers;
+	for (size_t begin = step; begin < paths.size(); begin += step) {
+		workers.push_back(std::thread(&BatchStat::statRange, &paths, &stats, begin, std::min(begin + step, paths.size())));
+	}
+	statRange(&paths, &stats, 0, std::min(step, paths.size()));
+	for (std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i) {
+		i->join();
+	}
+}
+
+void BatchStat::statRange (const PathList* paths, FileStatList* stats, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i) {
+		Unix::statPath((*paths)[i].constData(), &(*stats)[i]);
+	}
+}
+
+#endif
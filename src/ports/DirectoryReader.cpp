@@ -0,0 +1,210 @@
+/*
+ * DirectoryReader.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DirectoryReader.h"
+#include "System.h"
+#include "common/Logger.h"
+
+#include <algorithm>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// names held in memory before a sorted run is written to disk
+const size_t CHUNK_SIZE = 65536;
+
+#ifdef __linux__
+const size_t GETDENTS_BUFFER = 65536;
+
+struct LinuxDirent64 {
+	quint64 d_ino;
+	qint64 d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+#endif
+}
+
+DirectoryReader::DirectoryReader () :
+	_chunk(), _position(0), _runs()
+{
+}
+
+DirectoryReader::~DirectoryReader ()
+{
+	close();
+}
+
+bool DirectoryReader::open (const QString& path)
+{
+	close();
+	if (!readEntries(path)) {
+		return false;
+	}
+
+	if (_runs.empty()) {
+		std::sort(_chunk.begin(), _chunk.end());
+		return true;
+	}
+	if (!_chunk.empty()) {
+		spill();
+	}
+	for (RunList::iterator i = _runs.begin(); i != _runs.end(); ++i) {
+		Run* run = *i;
+		run->file.seek(0);
+		run->stream.setDevice(&run->file);
+		advance(run);
+	}
+	return true;
+}
+
+bool DirectoryReader::next (QString& name)
+{
+	if (_runs.empty()) {
+		if (_position >= _chunk.size()) {
+			return false;
+		}
+		name = _chunk[_position++];
+		return true;
+	}
+
+	Run* first = NULL;
+	for (RunList::const_iterator i = _runs.begin(); i != _runs.end(); ++i) {
+		if ((*i)->valid && (!first || (*i)->head < first->head)) {
+			first = *i;
+		}
+	}
+	if (!first) {
+		return false;
+	}
+	name = first->head;
+	advance(first);
+	return true;
+}
+
+void DirectoryReader::close ()
+{
+	for (RunList::iterator i = _runs.begin(); i != _runs.end(); ++i) {
+		delete *i;
+	}
+	_runs.clear();
+	_chunk.clear();
+	_position = 0;
+}
+
+bool DirectoryReader::readEntries (const QString& path)
+{
+#ifdef __linux__
+	const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	std::vector<char> buffer(GETDENTS_BUFFER);
+	long read;
+	while ((read = syscall(SYS_getdents64, fd, &buffer[0], buffer.size())) > 0) {
+		for (long offset = 0; offset < read;) {
+			const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(&buffer[offset]);
+			offset += entry->d_reclen;
+
+			// hidden entries including . and .. are not listed
+			if (entry->d_name[0] == '.') {
+				continue;
+			}
+			unsigned char type = entry->d_type;
+			if (type == DT_UNKNOWN) {
+				struct stat st;
+				if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+					continue;
+				}
+				type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+			}
+			if (type == DT_DIR || type == DT_REG) {
+				add(QFile::decodeName(entry->d_name));
+			}
+		}
+	}
+	::close(fd);
+	if (read < 0) {
+		warning("failed to read directory " + path);
+		return false;
+	}
+#else
+	QDirIterator iterator(path, QDir::Dirs | QDir::Files | QDir::NoSymLinks | QDir::NoDotAndDotDot);
+	while (iterator.hasNext()) {
+		iterator.next();
+		add(iterator.fileName());
+	}
+#endif
+	return true;
+}
+
+void DirectoryReader::add (const QString& name)
+{
+	_chunk.push_back(name);
+	if (_chunk.size() >= CHUNK_SIZE) {
+		spill();
+	}
+}
+
+void DirectoryReader::spill ()
+{
+	std::sort(_chunk.begin(), _chunk.end());
+	Run* run = new Run();
+	run->valid = false;
+	if (!run->file.open()) {
+		System.exit("failed to create a temporary file for sorting directory entries", EXIT_FAILURE);
+	}
+	run->stream.setDevice(&run->file);
+	for (std::vector<QString>::const_iterator i = _chunk.begin(); i != _chunk.end(); ++i) {
+		run->stream << *i;
+	}
+	run->file.flush();
+	_runs.push_back(run);
+	debug("spilled " + QString::number(_chunk.size()) + " directory entries to " + run->file.fileName());
+	_chunk.clear();
+}
+
+void DirectoryReader::advance (Run* run)
+{
+	run->valid = !run->stream.atEnd();
+	if (run->valid) {
+		run->stream >> run->head;
+	}
+}
@@ -0,0 +1,75 @@
+/*
+ * DirectoryReader.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <QDataStream>
+#include <QString>
+#include <QTemporaryFile>
+
+/**
+ * Reads the names of a directory in the order of QDir::Name without holding the whole listing.
+ * Names are collected in chunks of a fixed size, a full chunk is sorted and spilled to a temporary
+ * file and the sorted runs are merged while next() is called. Directories with less than one chunk
+ * of entries are sorted in memory. Hidden entries, symbolic links and special files are skipped
+ * like QDir does without the Hidden and System filters. On Linux the entries are read with
+ * getdents64, elsewhere through QDirIterator.
+ */
+class DirectoryReader {
+private:
+	DirectoryReader (const DirectoryReader&);
+	DirectoryReader& operator= (const DirectoryReader&);
+
+public:
+	DirectoryReader ();
+	~DirectoryReader ();
+
+	bool open (const QString& path);
+	bool next (QString& name);
+	void close ();
+
+private:
+	struct Run {
+		QTemporaryFile file;
+		QDataStream stream;
+		QString head;
+		bool valid;
+	};
+	typedef std::vector<Run*> RunList;
+
+	bool readEntries (const QString& path);
+	void add (const QString& name);
+	void spill ();
+	void advance (Run* run);
+
+	std::vector<QString> _chunk;
+	size_t _position;
+	RunList _runs;
+};
@@ -0,0 +1,168 @@
+/*
+ * DirectoryWatcher.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "DirectoryWatcher.h"
+#include "common/Logger.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileInfoList>
+#include <QSocketNotifier>
+
+#ifdef __linux__
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const int QUIET_MSECS = 10;
+#ifdef __linux__
+const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR
+		| IN_DONT_FOLLOW;
+#endif
+}
+
+DirectoryWatcher::DirectoryWatcher (QObject* parent) :
+	QObject(parent), _notifier(NULL), _timer(), _watches(), _changes(), _fd(-1)
+{
+	_timer.setSingleShot(true);
+	_timer.setInterval(QUIET_MSECS);
+	connect(&_timer, SIGNAL(timeout()), this, SIGNAL(changed()));
+}
+
+DirectoryWatcher::~DirectoryWatcher ()
+{
+	delete _notifier;
+#ifdef __linux__
+	if (_fd > -1) {
+		close(_fd);
+	}
+#endif
+}
+
+bool DirectoryWatcher::watch (const QDir& root)
+{
+#ifdef __linux__
+	_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_fd < 0) {
+		error("failed to initialize inotify: " + QString(strerror(errno)));
+		return false;
+	}
+	addWatch(root.absolutePath());
+	_notifier = new QSocketNotifier(_fd, QSocketNotifier::Read);
+	connect(_notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+	info("watching " + QString::number(_watches.size()) + " directories in " + root.path());
+	return true;
+#else
+	Q_UNUSED(root);
+	warning("watch mode is only supported on linux");
+	return false;
+#endif
+}
+
+DirectoryWatcher::ChangeList DirectoryWatcher::takeChanges ()
+{
+	ChangeList changes = _changes;
+	_changes.clear();
+	return changes;
+}
+
+void DirectoryWatcher::addWatch (const QString& path)
+{
+#ifdef __linux__
+	const int wd = inotify_add_watch(_fd, QFile::encodeName(path).constData(), WATCH_MASK);
+	if (wd < 0) {
+		warning("failed to watch " + path + ": " + QString(strerror(errno)));
+		return;
+	}
+	_watches[wd] = path;
+
+	QDir dir(path);
+	const QFileInfoList list = dir.entryInfoList(QDir::Dirs | QDir::NoSymLinks | QDir::NoDotAndDotDot);
+	for (int i = 0; i < list.size(); ++i) {
+		addWatch(list.at(i).filePath());
+	}
+#else
+	Q_UNUSED(path);
+#endif
+}
+
+void DirectoryWatcher::readEvents ()
+{
+#ifdef __linux__
+	char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+	while (true) {
+		const ssize_t length = read(_fd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			break;
+		}
+
+		for (char* ptr = buffer; ptr < buffer + length;) {
+			const struct inotify_event* event = reinterpret_cast<const struct inotify_event*> (ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				warning("inotify queue overflow, listing all directories again");
+				for (QHash<int, QString>::const_iterator i = _watches.constBegin(); i != _watches.constEnd(); ++i) {
+					_changes[i.value()].clear();
+				}
+				continue;
+			}
+
+			const QString dir = _watches.value(event->wd);
+			if (event->mask & IN_IGNORED) {
+				_watches.remove(event->wd);
+				continue;
+			}
+			if (dir.isEmpty() || event->len == 0) {
+				continue;
+			}
+
+			const QString name = QFile::decodeName(event->name);
+			if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+				addWatch(dir + "/" + name);
+			}
+
+			ChangeList::iterator changes = _changes.find(dir);
+			if (changes == _changes.end()) {
+				_changes[dir].insert(name);
+			} else if (!changes.value().isEmpty()) {
+				changes.value().insert(name);
+			}
+		}
+	}
+
+	if (!_changes.isEmpty()) {
+		_timer.start();
+	}
+#endif
+}
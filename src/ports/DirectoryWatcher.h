@@ -0,0 +1,72 @@
+/*
+ * DirectoryWatcher.h
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <QDir>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+class QSocketNotifier;
+
+/**
+ * Watches a directory tree for added, removed, renamed and rewritten entries. Events are collected
+ * per directory and reported through changed() once the tree has been quiet for a few milliseconds.
+ * An empty name set for a directory means that the whole directory has to be listed again.
+ */
+class DirectoryWatcher: public QObject {
+	Q_OBJECT
+
+public:
+	typedef QHash<QString, QSet<QString> > ChangeList;
+	typedef ChangeList::const_iterator ChangeListConstIter;
+
+	explicit DirectoryWatcher (QObject* parent = 0);
+	~DirectoryWatcher ();
+
+	bool watch (const QDir& root);
+	ChangeList takeChanges ();
+
+signals:
+	void changed ();
+
+private slots:
+	void readEvents ();
+
+private:
+	void addWatch (const QString& path);
+
+	QSocketNotifier* _notifier;
+	QTimer _timer;
+	QHash<int, QString> _watches;
+	ChangeList _changes;
+	int _fd;
+};
@@ -28,14 +28,33 @@
 
 #pragma once
 
+#include <QByteArray>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QString>
+#include <QStringList>
 
+#include <algorithm>
 #include <stdlib.h>
+#include <thread>
+#include <vector>
 
 #include "common/Logger.h"
 #include "common/Version.h"
 
+struct FileStat {
+	qint64 size;
+	qint64 mtime;
+	quint64 inode;
+	// hard links, sub directories plus two for a directory on most Unix file systems
+	quint64 links;
+	bool dir;
+	bool exists;
+};
+typedef std::vector<FileStat> FileStatList;
+
 class ISystem {
 private:
 	ISystem (const ISystem&);
@@ -67,6 +86,70 @@ public:
 		return tempDir;
 	}
 
+	/**
+	 * Fills in size, modification time in nanoseconds, inode, link count and type of a path. The
+	 * default implementation only has millisecond timestamps and no inode numbers or link counts.
+	 */
+	virtual bool getFileStat (const QString& path, FileStat* stat) const
+	{
+		QFileInfo fileInfo(path);
+		if (!fileInfo.exists()) {
+			return false;
+		}
+		stat->size = fileInfo.size();
+		stat->mtime = fileInfo.lastModified().toMSecsSinceEpoch() * 1000000;
+		stat->inode = 0;
+		stat->links = 0;
+		stat->dir = fileInfo.isDir();
+		stat->exists = true;
+		return true;
+	}
+
+	/**
+	 * Fetches the stats of many paths at once, paths that cannot be read have exists set to false.
+	 */
+	virtual void getFileStats (const QStringList& paths, FileStatList& stats) const
+	{
+		// the calls mostly wait on the filesystem, so the paths are split over more threads than cores
+		const int chunk = 256;
+		const int count = std::min((paths.size() + chunk - 1) / chunk, 16);
+		const int step = count > 0 ? (paths.size() + count - 1) / count : 0;
+		stats.resize(paths.size());
+
+		std::vector<std::thread> workers;
+		for (int begin = step; begin < paths.size(); begin += step) {
+			workers.push_back(std::thread(&ISystem::getFileStatRange, this, &paths, &stats, begin,
+					std::min(begin + step, paths.size())));
+		}
+		getFileStatRange(&paths, &stats, 0, std::min(step, paths.size()));
+		for (std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i) {
+			i->join();
+		}
+	}
+
+	/**
+	 * Creates or truncates a file and writes the header followed by the body.
+	 */
+	virtual bool writeFile (const QString& path, const QByteArray& header, const QByteArray& body) const
+	{
+		QFile file(path);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			return false;
+		}
+		const bool written = file.write(header) == header.size() && file.write(body) == body.size();
+		file.close();
+		return written;
+	}
+
+	/**
+	 * Moves a file over an existing one, atomically where the platform allows it.
+	 */
+	virtual bool replaceFile (const QString& from, const QString& to) const
+	{
+		QFile::remove(to);
+		return QFile::rename(from, to);
+	}
+
 	virtual bool makeDir (const QString& name) const
 	{
 		QDir pwd = getCurWorkDir();
@@ -97,4 +180,12 @@ public:
 		}
 		::exit(errorCode);
 	}
+
+private:
+	void getFileStatRange (const QStringList* paths, FileStatList* stats, int begin, int end) const
+	{
+		for (int i = begin; i < end; ++i) {
+			(*stats)[i].exists = getFileStat(paths->at(i), &(*stats)[i]);
+		}
+	}
 };
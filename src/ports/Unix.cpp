@@ -29,16 +29,22 @@
 #ifndef __WIN32__
 
 #include "Unix.h"
+#include "BatchStat.h"
 #include "common/Logger.h"
 #include "common/Version.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <pwd.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <QFile>
+
 Unix::Unix () :
 	_user()
 {
@@ -65,4 +71,78 @@ QString Unix::getCurrentUser () const
 	return _user;
 }
 
+bool Unix::getFileStat (const QString& path, FileStat* stat) const
+{
+	return statPath(QFile::encodeName(path).constData(), stat);
+}
+
+void Unix::getFileStats (const QStringList& paths, FileStatList& stats) const
+{
+	BatchStat::stat(paths, stats);
+}
+
+bool Unix::writeFile (const QString& path, const QByteArray& header, const QByteArray& body) const
+{
+	const int fd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct iovec parts[2];
+	parts[0].iov_base = const_cast<char*>(header.constData());
+	parts[0].iov_len = header.size();
+	parts[1].iov_base = const_cast<char*>(body.constData());
+	parts[1].iov_len = body.size();
+
+	// a single writev unless the kernel accepts only part of it
+	struct iovec* part = parts;
+	int count = 2;
+	while (count > 0) {
+		const ssize_t written = ::writev(fd, part, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			::close(fd);
+			return false;
+		}
+		size_t left = written;
+		while (count > 0 && left >= part->iov_len) {
+			left -= part->iov_len;
+			++part;
+			--count;
+		}
+		if (count > 0) {
+			part->iov_base = static_cast<char*>(part->iov_base) + left;
+			part->iov_len -= left;
+		}
+	}
+	return ::close(fd) == 0;
+}
+
+bool Unix::replaceFile (const QString& from, const QString& to) const
+{
+	return ::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+}
+
+bool Unix::statPath (const char* path, FileStat* stat)
+{
+	struct stat st;
+	if (::stat(path, &st) != 0) {
+		stat->exists = false;
+		return false;
+	}
+	stat->size = st.st_size;
+#ifdef __MACOSX__
+	stat->mtime = qint64(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	stat->mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+	stat->inode = st.st_ino;
+	stat->links = st.st_nlink;
+	stat->dir = S_ISDIR(st.st_mode);
+	stat->exists = true;
+	return true;
+}
+
 #endif
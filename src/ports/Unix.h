@@ -39,6 +39,12 @@ public:
 
 	QDir getCurWorkDir () const;
 	QString getCurrentUser () const;
+	bool getFileStat (const QString& path, FileStat* stat) const;
+	void getFileStats (const QStringList& paths, FileStatList& stats) const;
+	bool writeFile (const QString& path, const QByteArray& header, const QByteArray& body) const;
+	bool replaceFile (const QString& from, const QString& to) const;
+
+	static bool statPath (const char* path, FileStat* stat);
 
 private:
 	QString _user;
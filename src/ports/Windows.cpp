@@ -65,4 +65,10 @@ QString Windows::getCurrentUser () const
 	return "";
 }
 
+bool Windows::replaceFile (const QString& from, const QString& to) const
+{
+	return MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(from).utf16()),
+			reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
 #endif
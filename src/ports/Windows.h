@@ -41,6 +41,7 @@ public:
 
 	QDir getCurWorkDir () const;
 	QString getCurrentUser () const;
+	bool replaceFile (const QString& from, const QString& to) const;
 };
 
 #endif /* WINDOWS_H_ */
@@ -0,0 +1,7 @@
+package
+{
+	public class ${name}
+	{
+		${loop1}[Embed(source="${path}", mimeType="${mime}")] public static const ${name}:Class;
+	}
+}
\ No newline at end of file
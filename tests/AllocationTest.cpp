@@ -0,0 +1,148 @@
+/*
+ * AllocationTest.cpp
+ * Copyright (c) 2012, Harry Kunz <harry.kunz@ymail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. You must have great looks
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "parsers/AbstractAssetsParser.h"
+#include "common/AllocationCounter.h"
+#include "constants/Content.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+/**
+ * Generates a fixture of every kind of class twice on one thread and fails when the second pass
+ * allocates while rendering. The first pass resolves the templates and grows the thread's buffer,
+ * after it rendering must not touch the heap. Writing the files is not counted.
+ */
+namespace {
+const char* const FILES[] = { "picture.png", "music.mp3", "data.xml", "frame0.png", "frame1.png" };
+
+class FixtureParser: public AbstractAssetsParser {
+public:
+	FixtureParser () :
+		_sprite(), _movieclip()
+	{
+		makeSprite(_sprite, "Walk", Content::SPRITE);
+		makeSprite(_movieclip, "Jump", Content::MOVIECLIP);
+	}
+
+	void parse ()
+	{
+		_compileList.clear();
+		generate("Picture", "picture.png");
+		generate("Music", "music.mp3");
+		generate("Data", "data.xml");
+		if (createFileSprite(&_sprite)) {
+			_compileList.push_back(_sprite.name);
+		}
+		if (createFileSprite(&_movieclip)) {
+			_compileList.push_back(_movieclip.name);
+		}
+		createMainClass();
+	}
+
+	unsigned long getAllocations () const
+	{
+		return getRenderAllocations();
+	}
+
+private:
+	static void makeSprite (SpriteAsset& sprite, const char* name, Content::Class clazz)
+	{
+		sprite.name = name;
+		sprite.clazz = clazz;
+		sprite.x = "10";
+		for (int i = 0; i < 2; ++i) {
+			AssetBit frame;
+			frame.path = QByteArray("frame").append(QByteArray::number(i)).append(".png");
+			frame.alpha = "0.5";
+			sprite.assets.push_back(frame);
+		}
+	}
+
+	void generate (const char* name, const char* path)
+	{
+		if (createFileCommon(name, path)) {
+			_compileList.push_back(name);
+		}
+	}
+
+	SpriteAsset _sprite;
+	SpriteAsset _movieclip;
+};
+
+bool run (bool consolidate)
+{
+	QTemporaryDir dir;
+	if (!dir.isValid()) {
+		fprintf(stderr, "cannot create a temporary directory\n");
+		return false;
+	}
+	for (size_t i = 0; i < sizeof(FILES) / sizeof(FILES[0]); ++i) {
+		QFile file(dir.path() + "/" + FILES[i]);
+		if (!file.open(QIODevice::WriteOnly)) {
+			fprintf(stderr, "cannot write %s\n", FILES[i]);
+			return false;
+		}
+	}
+
+	FixtureParser parser;
+	parser.setTargetDir(QDir(dir.path()));
+	parser.setTempDir(QDir(dir.path()));
+	parser.setSniffTypes(true);
+	parser.setConsolidate(consolidate);
+	parser.setKeepWorkspace(true);
+	parser.init();
+
+	parser.parse();
+	const unsigned long warmed = parser.getAllocations();
+	parser.parse();
+	const unsigned long allocations = parser.getAllocations() - warmed;
+
+	printf("%s: %lu allocations on the first pass, %lu on the second\n",
+			consolidate ? "consolidated" : "single classes", warmed, allocations);
+	return allocations == 0;
+}
+}
+
+int main ()
+{
+	// a build without the counter still reads zero after allocating
+	int* volatile probe = new int(0);
+	delete probe;
+	if (AllocationCounter::get() == 0) {
+		fprintf(stderr, "built without ALLOCATION_GUARD, nothing is counted\n");
+		return EXIT_FAILURE;
+	}
+	const bool single = run(false);
+	const bool consolidated = run(true);
+	return single && consolidated ? EXIT_SUCCESS : EXIT_FAILURE;
+}